@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include "StringSearch.h"
+
+/**
+ * Delimiter search throughput: scans a buffer of text lines for every delimiter in turn,
+ * the way a line-based protocol consumes its input. The buffer is cache-sized like a socket read,
+ * and scanned kPasses times per round. Build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers
+ **/
+namespace
+{
+const size_t kDataSize = 256 * 1024;
+const int kPasses = 256;
+const int kRounds = 5;
+
+std::string makeLines(size_t lineLength)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> printable(' ', '~');
+    std::string data(kDataSize, '\0');
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = static_cast<char>(printable(rng));
+        if (i % lineLength == lineLength - 2)
+        {
+            data[i] = '\r';
+            data[++i] = '\n';
+        }
+    }
+    return data;
+}
+
+using Finder = std::function<const char *(const char *, const char *)>;
+
+// Returns the number of matches, prints the best throughput of kRounds
+size_t run(const char *name, const std::string &data, const Finder &find, size_t skip)
+{
+    size_t matches = 0;
+    double best = 0;
+    for (int round = 0; round < kRounds; ++round)
+    {
+        matches = 0;
+        auto start = std::chrono::steady_clock::now();
+        const char *end = data.data() + data.size();
+        for (int pass = 0; pass < kPasses; ++pass)
+        {
+            matches = 0;
+            for (const char *p = data.data(); p < end;)
+            {
+                const char *hit = find(p, end);
+                if (hit == nullptr)
+                {
+                    break;
+                }
+                ++matches;
+                p = hit + skip;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double mbps = static_cast<double>(data.size()) * kPasses / seconds / (1024 * 1024);
+        best = std::max(best, mbps);
+    }
+    printf("%-28s %10.0f MB/s  %zu matches\n", name, best, matches);
+    return matches;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t lineLength = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 128;
+    if (lineLength < 2)
+    {
+        fprintf(stderr, "usage: %s [line length >= 2]\n", argv[0]);
+        return 1;
+    }
+    std::string data = makeLines(lineLength);
+    printf("%zu KB of %zu-byte lines, %d passes, best of %d rounds\n", kDataSize >> 10, lineLength, kPasses, kRounds);
+
+    static const char kCRLF[] = "\r\n";
+    size_t expected = run("findCRLF std::search", data, [](const char *b, const char *e) {
+        const char *hit = std::search(b, e, kCRLF, kCRLF + 2);
+        return hit == e ? nullptr : hit;
+    }, 2);
+    const search::Impl impls[] = {search::kScalar, search::kSse2, search::kAvx2};
+    const char *implNames[] = {"scalar", "sse2", "avx2"};
+    for (int i = 0; i < 3; ++i)
+    {
+        search::Impl impl = impls[i];
+        std::string name = std::string("findCRLF ") + implNames[i];
+        if (run(name.c_str(), data, [impl](const char *b, const char *e) { return search::findCRLF(impl, b, e); }, 2) != expected)
+        {
+            fprintf(stderr, "%s: wrong match count\n", name.c_str());
+            return 1;
+        }
+    }
+    printf("dispatch picks %s\n", implNames[search::bestImpl()]);
+
+    run("findEOL std::find", data, [](const char *b, const char *e) {
+        const char *hit = std::find(b, e, '\n');
+        return hit == e ? nullptr : hit;
+    }, 1);
+    run("findEOL memchr", data, [](const char *b, const char *e) { return search::findEOL(b, e); }, 1);
+
+    static const char kSet[] = "\r\n:;";
+    expected = run("findAny std::find_first_of", data, [](const char *b, const char *e) {
+        const char *hit = std::find_first_of(b, e, kSet, kSet + 4);
+        return hit == e ? nullptr : hit;
+    }, 1);
+    for (int i = 0; i < 3; ++i)
+    {
+        search::Impl impl = impls[i];
+        std::string name = std::string("findAny ") + implNames[i];
+        if (run(name.c_str(), data, [impl](const char *b, const char *e) { return search::findAny(impl, b, e, kSet, 4); }, 1) != expected)
+        {
+            fprintf(stderr, "%s: wrong match count\n", name.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -5,6 +5,7 @@
 #include "noncopyable.h"
 #include "Socket.h"
 #include "Channel.h"
+#include "TimerId.h"
 
 class EventLoop;
 class InetAddress;
@@ -24,11 +25,22 @@ public:
     void listen();
 
 private:
+    static const int kMaxAcceptsPerRead = 64; // Upper bound of connections accepted in one wakeup, so other channels of the loop are not starved
+    static constexpr double kAcceptBackoffSeconds = 0.1; // Pause of accepting when out of fds with no reserve left
+
     void handleRead(); // Handle new user connection event
+    // Accept and drop one pending connection with the reserved fd when the process ran out of fds.
+    // False if the reserve could not be reopened, nothing was dropped then
+    bool dropPendingConnection();
+    // End of an accept pause, listenfd is watched again
+    void resumeAccept();
 
     EventLoop *loop_; // The baseLoop defined by the user, also called mainLoop
     Socket acceptSocket_; // Dedicated socket for receiving new connections
     Channel acceptChannel_; // Dedicated channel for listening to new connections
     NewConnectionCallback NewConnectionCallback_; // Callback function for new connections
     bool listenning_; // Whether it is listening
+    int idleFd_; // Reserved fd (/dev/null) given up on EMFILE to shed pending connections
+    bool backingOff_; // listenfd is not watched until backoffTimer_ fires
+    TimerId backoffTimer_;
 };
\ No newline at end of file
@@ -4,8 +4,16 @@
 #include <string>
 #include <algorithm>
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <endian.h>
+
+#include "memoryPool.h"
+#include "StringSearch.h"
 
 // Definition of the underlying buffer type for the network library
+// Storage comes from memoryPool::ChunkPool, sizes are rounded up to its chunk classes so no chunk space is wasted
 class Buffer
 {
 public:
@@ -13,10 +21,21 @@ public:
     static const size_t kInitialSize = 1024;
 
     explicit Buffer(size_t initalSize = kInitialSize)
-        : buffer_(kCheapPrepend + initalSize)
+        : buffer_(memoryPool::ChunkPool::roundUp(kCheapPrepend + initalSize))
         , readerIndex_(kCheapPrepend)
         , writerIndex_(kCheapPrepend)
+        , peak_(0)
+        , highWater_(0)
+    {
+    }
+
+    void swap(Buffer &rhs)
     {
+        buffer_.swap(rhs.buffer_);
+        std::swap(readerIndex_, rhs.readerIndex_);
+        std::swap(writerIndex_, rhs.writerIndex_);
+        std::swap(peak_, rhs.peak_);
+        std::swap(highWater_, rhs.highWater_);
     }
 
     size_t readableBytes() const { return writerIndex_ - readerIndex_; }
@@ -51,6 +70,17 @@ public:
         return result;
     }
 
+    // Search the readable bytes (from start, which must lie within them), nullptr if not found
+    const char *findCRLF() const { return search::findCRLF(peek(), beginWrite()); }
+    const char *findCRLF(const char *start) const { return search::findCRLF(start, beginWrite()); }
+    const char *findEOL() const { return search::findEOL(peek(), beginWrite()); }
+    const char *findEOL(const char *start) const { return search::findEOL(start, beginWrite()); }
+    const char *findChar(char c) const { return search::findChar(peek(), beginWrite(), c); }
+    const char *findChar(char c, const char *start) const { return search::findChar(start, beginWrite(), c); }
+    // First byte that is any of set[0, setSize)
+    const char *findAny(const char *set, size_t setSize) const { return search::findAny(peek(), beginWrite(), set, setSize); }
+    const char *findAny(const char *set, size_t setSize, const char *start) const { return search::findAny(start, beginWrite(), set, setSize); }
+
     // buffer_.size - writerIndex_
     void ensureWritableBytes(size_t len)
     {
@@ -66,16 +96,150 @@ public:
         ensureWritableBytes(len);
         std::copy(data, data+len, beginWrite());
         writerIndex_ += len;
+        notePeak();
+    }
+    void append(const void *data, size_t len) { append(static_cast<const char *>(data), len); }
+
+    // Append integers in network byte order
+    void appendInt64(int64_t x)
+    {
+        uint64_t be = htobe64(static_cast<uint64_t>(x));
+        append(&be, sizeof be);
+    }
+    void appendInt32(int32_t x)
+    {
+        uint32_t be = htobe32(static_cast<uint32_t>(x));
+        append(&be, sizeof be);
+    }
+    void appendInt16(int16_t x)
+    {
+        uint16_t be = htobe16(static_cast<uint16_t>(x));
+        append(&be, sizeof be);
+    }
+    void appendInt8(int8_t x) { append(&x, sizeof x); }
+
+    // Read integers in network byte order from the readable bytes, which must hold at least sizeof the integer.
+    // peek leaves them in the buffer, read retrieves them
+    int64_t peekInt64() const
+    {
+        assert(readableBytes() >= sizeof(int64_t));
+        uint64_t be;
+        ::memcpy(&be, peek(), sizeof be);
+        return static_cast<int64_t>(be64toh(be));
+    }
+    int32_t peekInt32() const
+    {
+        assert(readableBytes() >= sizeof(int32_t));
+        uint32_t be;
+        ::memcpy(&be, peek(), sizeof be);
+        return static_cast<int32_t>(be32toh(be));
+    }
+    int16_t peekInt16() const
+    {
+        assert(readableBytes() >= sizeof(int16_t));
+        uint16_t be;
+        ::memcpy(&be, peek(), sizeof be);
+        return static_cast<int16_t>(be16toh(be));
+    }
+    int8_t peekInt8() const
+    {
+        assert(readableBytes() >= sizeof(int8_t));
+        return static_cast<int8_t>(*peek());
+    }
+    int64_t readInt64()
+    {
+        int64_t x = peekInt64();
+        retrieve(sizeof x);
+        return x;
+    }
+    int32_t readInt32()
+    {
+        int32_t x = peekInt32();
+        retrieve(sizeof x);
+        return x;
+    }
+    int16_t readInt16()
+    {
+        int16_t x = peekInt16();
+        retrieve(sizeof x);
+        return x;
+    }
+    int8_t readInt8()
+    {
+        int8_t x = peekInt8();
+        retrieve(sizeof x);
+        return x;
+    }
+
+    /**
+     * Write in front of the readable bytes, into the prependable space: serialize the body first,
+     * then prepend its length header without moving it. At least kCheapPrepend bytes are always prependable
+     **/
+    void prepend(const void *data, size_t len)
+    {
+        assert(len <= prependableBytes());
+        readerIndex_ -= len;
+        ::memcpy(begin() + readerIndex_, data, len);
+    }
+    void prependInt64(int64_t x)
+    {
+        uint64_t be = htobe64(static_cast<uint64_t>(x));
+        prepend(&be, sizeof be);
+    }
+    void prependInt32(int32_t x)
+    {
+        uint32_t be = htobe32(static_cast<uint32_t>(x));
+        prepend(&be, sizeof be);
+    }
+    void prependInt16(int16_t x)
+    {
+        uint16_t be = htobe16(static_cast<uint16_t>(x));
+        prepend(&be, sizeof be);
     }
+    void prependInt8(int8_t x) { prepend(&x, sizeof x); }
+
     char *beginWrite() { return begin() + writerIndex_; }
     const char *beginWrite() const { return begin() + writerIndex_; }
 
+    // Capacity of the underlying array, prepend area excluded
+    size_t capacity() const { return buffer_.size() - kCheapPrepend; }
+
+    /**
+     * Give back capacity recent traffic no longer needs, meant to be called whenever the buffer drains.
+     * The high-water mark is the largest readable size seen since the previous call, or half the previous mark
+     * if that is larger, so it decays after a burst. Memory is only released once the capacity exceeds
+     * 4x the mark: steady traffic never reallocates, a single large message is given back after a few small ones.
+     **/
+    void trim()
+    {
+        highWater_ = peak_ > highWater_ / 2 ? peak_ : highWater_ / 2;
+        peak_ = readableBytes();
+        const size_t target = highWater_ > kInitialSize ? highWater_ : kInitialSize;
+        if (capacity() > 4 * target)
+        {
+            shrink(target - (peak_ < target ? peak_ : target));
+        }
+    }
+
+    // Reallocate the array to hold exactly the readable bytes plus reserve writable bytes
+    void shrink(size_t reserve)
+    {
+        const size_t readable = readableBytes();
+        Storage buf(memoryPool::ChunkPool::roundUp(kCheapPrepend + readable + reserve));
+        std::copy(peek(), peek() + readable, buf.begin() + kCheapPrepend);
+        buffer_.swap(buf);
+        readerIndex_ = kCheapPrepend;
+        writerIndex_ = readerIndex_ + readable;
+    }
+
     // Read data from fd
     ssize_t readFd(int fd, int *saveErrno);
     // Send data through fd
     ssize_t writeFd(int fd, int *saveErrno);
 
 private:
+    using Storage = std::vector<char, memoryPool::PoolAllocator<char>>;
+
     // The address of the first element of the underlying array of vector, which is the starting address of the array
     char *begin() { return &*buffer_.begin(); }
     const char *begin() const { return &*buffer_.begin(); }
@@ -88,7 +252,9 @@ private:
          **/
         if (writableBytes() + prependableBytes() < len + kCheapPrepend) // That is, len > remaining space before xxx + writer part
         {
-            buffer_.resize(writerIndex_ + len);
+            // Grow geometrically, a message arriving over many reads costs O(log n) reallocations instead of one per read
+            const size_t doubled = buffer_.size() * 2;
+            buffer_.resize(memoryPool::ChunkPool::roundUp(doubled > writerIndex_ + len ? doubled : writerIndex_ + len));
         }
         else // Here len <= xxx + writer, move reader to start from xxx to make continuous space after xxx
         {
@@ -103,7 +269,18 @@ private:
         }
     }
 
-    std::vector<char> buffer_;
+    void notePeak()
+    {
+        if (readableBytes() > peak_)
+        {
+            peak_ = readableBytes();
+        }
+    }
+
+    Storage buffer_;
     size_t readerIndex_;
     size_t writerIndex_;
+
+    size_t peak_;      // Largest readable size since the last trim()
+    size_t highWater_; // Decaying high-water mark of the readable size
 };
@@ -12,6 +12,8 @@ using ConnectionCallback = std::function<void(const TcpConnectionPtr &)>;
 using CloseCallback = std::function<void(const TcpConnectionPtr &)>;
 using WriteCompleteCallback = std::function<void(const TcpConnectionPtr &)>;
 using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr &, size_t)>;
+// Progress of a sendFile range: bytes sent so far, range length. sent == total reports completion
+using SendFileCallback = std::function<void(const TcpConnectionPtr &, size_t sent, size_t total)>;
 
 using MessageCallback = std::function<void(const TcpConnectionPtr &,
                                            Buffer *,
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "noncopyable.h"
+
+/**
+ * Chained variant of Buffer, for streams too large to keep contiguous (e.g. multi-GB uploads)
+ *
+ * | block: | read | readable | | block: | readable | | block: | readable | writable | | spare block | ...
+ *
+ * Data lives in a list of fixed-size blocks taken from memoryPool::ChunkPool. Appending never moves bytes already
+ * stored and retrieving frees whole blocks from the head, so every byte is copied at most once whatever the stream size.
+ * The price is that readable bytes are not contiguous: peek() only covers the head block, readableIovecs() exports
+ * all of them for writev, and writableIovecs()/hasWritten() let readv fill the blocks directly.
+ **/
+class ChainBuffer : noncopyable
+{
+public:
+    static const size_t kBlockSize = 16 * 1024;
+    static const size_t kReadSize = 64 * 1024; // Writable space readFd makes sure of before every read
+
+    ChainBuffer();
+    ~ChainBuffer();
+
+    void swap(ChainBuffer &rhs);
+
+    size_t readableBytes() const { return readable_; }
+
+    // Start of the readable bytes, contiguous for contiguousBytes() bytes (the rest of the head block)
+    const char *peek() const;
+    size_t contiguousBytes() const;
+    // Copy up to len readable bytes starting offset bytes after peek() to dst without retrieving them, returns the count copied
+    size_t copyOut(char *dst, size_t len, size_t offset = 0) const;
+
+    void retrieve(size_t len);
+    void retrieveAll();
+    std::string retrieveAllAsString() { return retrieveAsString(readableBytes()); }
+    std::string retrieveAsString(size_t len);
+
+    // Copy [data, data+len) to the tail, allocating blocks as needed
+    void append(const char *data, size_t len);
+
+    // Fill vec with the readable segments in order, up to maxIovecs of them. Returns the number filled
+    int readableIovecs(struct iovec *vec, int maxIovecs) const;
+    // Make at least len bytes writable and fill vec with the writable segments, up to maxIovecs of them.
+    // Returns the number filled; the written bytes become readable with hasWritten()
+    int writableIovecs(struct iovec *vec, int maxIovecs, size_t len);
+    void hasWritten(size_t len);
+
+    // Free the spare blocks kept at the tail for the next reads
+    void shrink();
+
+    // readv straight into the blocks, at most kReadSize bytes
+    ssize_t readFd(int fd, int *saveErrno);
+    // writev of the readable segments
+    ssize_t writeFd(int fd, int *saveErrno);
+
+private:
+    static const int kMaxIovecs = 64;
+
+    struct Block
+    {
+        char *data;
+        size_t readIndex;
+        size_t writeIndex;
+    };
+
+    // Free space after the last written byte: the rest of the last data block plus the spare blocks
+    size_t writableBytes() const;
+    void ensureWritableBytes(size_t len);
+
+    std::deque<Block> blocks_; // Data blocks (writeIndex > 0), then spare_ empty blocks
+    size_t spare_;
+    size_t readable_; // Readable bytes over all blocks
+};
@@ -49,6 +49,11 @@ public:
     bool isWriting() const { return events_ & kWriteEvent; }
     bool isReading() const { return events_ & kReadEvent; }
 
+    // Edge-triggered channels are registered once for both read and write (EPOLLET), so toggling
+    // reading/writing only changes which callbacks run and no longer costs an epoll_ctl
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    bool isEdgeTriggered() const { return edgeTriggered_; }
+
     int index() { return index_; }
     void set_index(int idx) { index_ = idx; }
 
@@ -69,6 +74,7 @@ private:
     int events_;      // Registered events of interest for fd
     int revents_;     // Specific events returned by Poller
     int index_;
+    bool edgeTriggered_; // Registered with EPOLLET, the owner must drain fd until EAGAIN
 
     std::weak_ptr<void> tie_;
     bool tied_;
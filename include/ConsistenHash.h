@@ -74,7 +74,7 @@ public:
      * @return The name of the node responsible for the key.
      * @throws std::runtime_error If the hash ring is empty (no nodes).
      */
-    size_t getNode(const std::string& key) {
+    std::string getNode(const std::string& key) {
         std::lock_guard<std::mutex> lock(mtx_); // Ensure thread safety
     if (circle_.empty()) {
             throw std::runtime_error("No nodes in consistent hash"); // Throw exception if ring is empty
@@ -86,7 +86,7 @@ public:
             // If it exceeds the maximum value of the ring, wrap around to the first node
         it = sortedHashes_.begin();
     }
-        return *it; // Return the corresponding hash value
+        return circle_[*it]; // Return the node owning this virtual node
     }
 
 private:
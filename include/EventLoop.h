@@ -4,14 +4,14 @@
 #include <vector>
 #include <atomic>
 #include <memory>
-#include <mutex>
 
 #include "noncopyable.h"
 #include "Timestamp.h"
 #include "CurrentThread.h"
 #include "TimerQueue.h"
+#include "Poller.h"
+#include "MpscQueue.h"
 class Channel;
-class Poller;
 
 // Event loop class, mainly contains two major modules: Channel and Poller (epoll abstraction)
 class EventLoop : noncopyable
@@ -19,7 +19,7 @@ class EventLoop : noncopyable
 public:
     using Functor = std::function<void()>;
 
-    EventLoop();
+    explicit EventLoop(Poller::Backend backend = Poller::kDefaultBackend);
     ~EventLoop();
 
     // Start event loop
@@ -47,21 +47,27 @@ public:
     /**
      * Timer task related functions
      */
-    void runAt(Timestamp timestamp, Functor &&cb)
+    TimerId runAt(Timestamp timestamp, Functor &&cb)
     {
-        timerQueue_->addTimer(std::move(cb), timestamp, 0.0);
+        return timerQueue_->addTimer(std::move(cb), timestamp, 0.0);
     }
 
-    void runAfter(double waitTime, Functor &&cb)
+    TimerId runAfter(double waitTime, Functor &&cb)
     {
         Timestamp time(addTime(Timestamp::now(), waitTime));
-        runAt(time, std::move(cb));
+        return runAt(time, std::move(cb));
     }
 
-    void runEvery(double interval, Functor &&cb)
+    TimerId runEvery(double interval, Functor &&cb)
     {
         Timestamp timestamp(addTime(Timestamp::now(), interval));
-        timerQueue_->addTimer(std::move(cb), timestamp, interval);
+        return timerQueue_->addTimer(std::move(cb), timestamp, interval);
+    }
+
+    // Cancel a timer returned by runAt/runAfter/runEvery, thread safe
+    void cancel(TimerId timerId)
+    {
+        timerQueue_->cancel(timerId);
     }
 
 private:
@@ -77,13 +83,13 @@ private:
 
     Timestamp pollRetureTime_; // The time when Poller returns the Channels where events occurred
     std::unique_ptr<Poller> poller_;
-    std::unique_ptr<TimerQueue> timerQueue_;
+    std::unique_ptr<TimerQueue> timerQueue_; // Registers its timerfd with poller_, so it is declared (and created) after it
     int wakeupFd_; // Function: When mainLoop gets a new user's Channel, it needs to select a subLoop through polling algorithm and wake up subLoop to process the Channel through this member
     std::unique_ptr<Channel> wakeupChannel_;
 
     ChannelList activeChannels_; // Return the list of all Channels where events are currently detected by Poller
 
     std::atomic_bool callingPendingFunctors_; // Indicates whether the current loop has callback operations to execute
-    std::vector<Functor> pendingFunctors_;    // Store all callback operations that the loop needs to execute
-    std::mutex mutex_;                        // Mutex to protect thread-safe operations on the above vector container
+    std::atomic_bool wakeupPending_;          // An enqueuer has already written wakeupFd_ since the last drain
+    MpscQueue<Functor> pendingFunctors_;      // Store all callback operations that the loop needs to execute, lock-free for cross-thread posts
 };
\ No newline at end of file
@@ -7,6 +7,7 @@
 
 #include "noncopyable.h"
 #include "Thread.h"
+#include "Poller.h"
 
 class EventLoop;
 
@@ -16,7 +17,8 @@ public:
     using ThreadInitCallback = std::function<void(EventLoop *)>;
 
     EventLoopThread(const ThreadInitCallback &cb = ThreadInitCallback(),
-                    const std::string &name = std::string());
+                    const std::string &name = std::string(),
+                    Poller::Backend backend = Poller::kDefaultBackend);
     ~EventLoopThread();
 
     EventLoop *startLoop();
@@ -30,4 +32,5 @@ private:
     std::mutex mutex_;             // Mutex
     std::condition_variable cond_; // Condition variable
     ThreadInitCallback callback_;
+    Poller::Backend backend_; // IO multiplexing backend of the loop created in threadFunc
 };
\ No newline at end of file
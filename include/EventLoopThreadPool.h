@@ -4,9 +4,11 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 #include "noncopyable.h"
 #include "ConsistenHash.h"
+#include "Poller.h"
 class EventLoop;
 class EventLoopThread;
 
@@ -19,6 +21,8 @@ public:
     ~EventLoopThreadPool();
 
     void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+    // IO multiplexing backend of the subloops, must be set before start()
+    void setPollerBackend(Poller::Backend backend) { backend_ = backend; }
 
     void start(const ThreadInitCallback &cb = ThreadInitCallback());
 
@@ -39,4 +43,6 @@ private:
     std::vector<std::unique_ptr<EventLoopThread>> threads_; // List of IO threads
     std::vector<EventLoop *> loops_; // List of EventLoops in the thread pool, pointing to EventLoop objects created by the EventLoopThread thread function.
     ConsistentHash hash_; // Consistent hash object
+    std::unordered_map<std::string, EventLoop *> nodeLoops_; // Node name in hash_ => its EventLoop
+    Poller::Backend backend_; // IO multiplexing backend of the subloops
 };
\ No newline at end of file
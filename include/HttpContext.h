@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stddef.h>
+#include <memory>
+
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+class Buffer;
+class HttpStreamWriter;
+
+/**
+ * Incremental HTTP/1.x request parser, one per connection
+ *
+ * | request line | header lines | blank line | body (Content-Length bytes) | next pipelined request ...
+ *
+ * Parsing starts at buf->peek(). Until the blank line has arrived only the new bytes are searched for it,
+ * then the whole head is parsed in one pass by httpparser::parseRequestHead.
+ * Nothing is copied and only empty lines in front of a request are retrieved: once a request is complete the caller handles request() while its bytes are
+ * still in buf, then retrieves requestBytes() of them and calls reset() before parsing the next one.
+ **/
+class HttpContext
+{
+public:
+    enum ParseResult
+    {
+        kNeedMore, // The request is not complete yet, wait for more input
+        kComplete, // request() is ready
+        kError     // Malformed or unsupported, errorStatus() says which response to send before closing
+    };
+
+    static const size_t kDefaultMaxHeaderBytes = 64 * 1024;
+    static const size_t kDefaultMaxBodyBytes = 64 * 1024 * 1024;
+
+    HttpContext();
+
+    ParseResult parseRequest(Buffer *buf, Timestamp receiveTime);
+
+    const HttpRequest &request() const { return request_; }
+    // Bytes of buf taken by the complete request, body included
+    size_t requestBytes() const { return scanned_; }
+    HttpResponse::StatusCode errorStatus() const { return errorStatus_; }
+
+    void setMaxHeaderBytes(size_t bytes) { maxHeaderBytes_ = bytes; }
+    void setMaxBodyBytes(size_t bytes) { maxBodyBytes_ = bytes; }
+
+    // Get ready for the next request
+    void reset();
+
+    // Response body being streamed, later requests wait until it is finished
+    void setStream(const std::shared_ptr<HttpStreamWriter> &stream) { stream_ = stream; }
+    bool streaming() const { return static_cast<bool>(stream_); }
+
+private:
+    enum ParseState
+    {
+        kExpectHead,
+        kExpectBody,
+        kGotAll
+    };
+
+    // Check the framing headers once the blank line is reached
+    bool finishHeaders(const char *base);
+    ParseResult fail(HttpResponse::StatusCode status);
+
+    ParseState state_;
+    HttpRequest request_;
+    size_t scanned_;    // Bytes from the start of the request already parsed (or searched for the end of the head)
+    size_t bodyLength_;
+    size_t maxHeaderBytes_;
+    size_t maxBodyBytes_;
+    HttpResponse::StatusCode errorStatus_;
+    std::shared_ptr<HttpStreamWriter> stream_;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+/**
+ * Vectorized parser of an HTTP/1.x request head (request line and header fields)
+ *
+ * The spans of the head are delimited by the first byte outside the characters allowed in them:
+ * the target ends at a space or control, a field name at ':' or anything not visible ASCII, a field value
+ * at a control other than HTAB. Those stop bytes are found 16 bytes at a time with SSE4.2 PCMPESTRI range
+ * matching or 32 at a time with AVX2 compares, and with lookup tables on other CPUs, the version being
+ * chosen at startup like StringSearch. Each byte of the head is looked at once.
+ **/
+namespace httpparser
+{
+// Pointer past the blank line ending the request head in [begin, end), nullptr if it has not arrived yet.
+// from: where to resume the search, bytes before it are known not to hold the blank line
+const char *findHeadEnd(const char *begin, const char *end, const char *from);
+
+// Parse the head in [begin, end), which must end with its blank line ("\r\n\r\n"). Fields are stored in req
+// as spans relative to begin. On failure *error is the status to answer with
+bool parseRequestHead(const char *begin, const char *end, HttpRequest *req, HttpResponse::StatusCode *error);
+
+// The implementations behind the dispatch, for benchmarks. Unsupported ones fall back to the scalar version
+enum Impl
+{
+    kScalar,
+    kSse42,
+    kAvx2
+};
+Impl bestImpl();
+bool parseRequestHead(Impl impl, const char *begin, const char *end, HttpRequest *req, HttpResponse::StatusCode *error);
+} // namespace httpparser
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+
+#include "Timestamp.h"
+
+/**
+ * A parsed HTTP request. It owns no bytes: every field is an offset into the connection's input buffer,
+ * turned into a std::string_view against the request's first byte, so the views are only valid while
+ * the request is being handled (the buffer may move or reallocate between reads, the offsets do not change).
+ **/
+class HttpRequest
+{
+public:
+    enum Method
+    {
+        kInvalid,
+        kGet,
+        kPost,
+        kHead,
+        kPut,
+        kDelete,
+        kOptions
+    };
+    enum Version
+    {
+        kUnknown,
+        kHttp10,
+        kHttp11
+    };
+
+    // Offset and length of a field, relative to the start of the request
+    struct Span
+    {
+        uint32_t offset;
+        uint32_t length;
+    };
+    struct Header
+    {
+        Span name;
+        Span value;
+    };
+
+    HttpRequest()
+        : base_(nullptr)
+        , method_(kInvalid)
+        , version_(kUnknown)
+        , path_{0, 0}
+        , query_{0, 0}
+        , body_{0, 0}
+    {
+    }
+
+    Method method() const { return method_; }
+    Version version() const { return version_; }
+    std::string_view methodString() const;
+    std::string_view path() const { return view(path_); }
+    // Part of the target after '?', empty if none
+    std::string_view query() const { return view(query_); }
+    std::string_view body() const { return view(body_); }
+    Timestamp receiveTime() const { return receiveTime_; }
+
+    // Value of the first header named field (case-insensitive), empty if absent
+    std::string_view getHeader(std::string_view field) const;
+    size_t headerCount() const { return headers_.size(); }
+    std::string_view headerName(size_t i) const { return view(headers_[i].name); }
+    std::string_view headerValue(size_t i) const { return view(headers_[i].value); }
+
+    // HTTP/1.1 keeps the connection open unless "Connection: close", HTTP/1.0 only with "Connection: keep-alive"
+    bool keepAlive() const;
+
+    // Parser side
+    void setMethod(Method method) { method_ = method; }
+    void setVersion(Version version) { version_ = version; }
+    void setPath(Span path) { path_ = path; }
+    void setQuery(Span query) { query_ = query; }
+    void setBody(Span body) { body_ = body; }
+    void setReceiveTime(Timestamp t) { receiveTime_ = t; }
+    void addHeader(Span name, Span value) { headers_.push_back(Header{name, value}); }
+    // Point the spans at the request's first byte, once the whole request is in the buffer
+    void setBase(const char *base) { base_ = base; }
+    // Reset for the next request; the header vector keeps its capacity
+    void reset();
+
+private:
+    std::string_view view(Span span) const { return std::string_view(base_ + span.offset, span.length); }
+
+    const char *base_;
+    Method method_;
+    Version version_;
+    Span path_;
+    Span query_;
+    Span body_;
+    std::vector<Header> headers_;
+    Timestamp receiveTime_;
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+#include "Buffer.h"
+
+class HttpStreamWriter;
+
+/**
+ * HTTP response under construction. Header lines are written straight into a Buffer as they are added,
+ * the body is moved, referenced, left in a file or produced on the fly, never concatenated: HttpServer writes
+ * the status line and headers into the connection's output and queues the body after them.
+ **/
+class HttpResponse
+{
+public:
+    enum StatusCode
+    {
+        kUnknown = 0,
+        k200Ok = 200,
+        k204NoContent = 204,
+        k206PartialContent = 206,
+        k301MovedPermanently = 301,
+        k304NotModified = 304,
+        k400BadRequest = 400,
+        k403Forbidden = 403,
+        k404NotFound = 404,
+        k405MethodNotAllowed = 405,
+        k413PayloadTooLarge = 413,
+        k416RangeNotSatisfiable = 416,
+        k431RequestHeaderFieldsTooLarge = 431,
+        k500InternalServerError = 500,
+        k501NotImplemented = 501,
+        k505HttpVersionNotSupported = 505
+    };
+
+    // Writes the next part of a streamed body, see HttpStreamWriter
+    using StreamProducer = std::function<void(HttpStreamWriter *)>;
+
+    explicit HttpResponse(bool closeConnection)
+        : statusCode_(kUnknown)
+        , closeConnection_(closeConnection)
+        , fileFd_(-1)
+        , fileOffset_(0)
+        , fileCount_(0)
+    {
+    }
+
+    void setStatusCode(StatusCode code) { statusCode_ = code; }
+    StatusCode statusCode() const { return statusCode_; }
+    static std::string_view statusMessage(StatusCode code);
+
+    void setCloseConnection(bool on) { closeConnection_ = on; }
+    bool closeConnection() const { return closeConnection_; }
+
+    // Content-Length and Connection are written by the server, don't add them
+    void addHeader(std::string_view name, std::string_view value);
+    void setContentType(std::string_view contentType) { addHeader("Content-Type", contentType); }
+
+    // Owned body, moved into the output queue when it is large
+    void setBody(std::string body)
+    {
+        body_ = std::move(body);
+        sharedBody_.reset();
+        fileFd_ = -1;
+        streamProducer_ = nullptr;
+    }
+    // Shared body (e.g. from a cache), queued by reference
+    void setBody(const std::shared_ptr<const std::string> &body)
+    {
+        sharedBody_ = body;
+        body_.clear();
+        fileFd_ = -1;
+        streamProducer_ = nullptr;
+    }
+    // count bytes of a file from offset, queued with sendFile. holder keeps fd open until they are sent
+    void setFileBody(int fd, off_t offset, size_t count, const std::shared_ptr<const void> &holder)
+    {
+        fileFd_ = fd;
+        fileOffset_ = offset;
+        fileCount_ = count;
+        fileHolder_ = holder;
+        body_.clear();
+        sharedBody_.reset();
+        streamProducer_ = nullptr;
+    }
+    // Body of unknown length, generated by producer once the headers are sent. It goes out with chunked
+    // transfer coding, or up to the end of the connection when that closes afterwards (HTTP/1.0 clients)
+    void setStreamBody(const StreamProducer &producer)
+    {
+        streamProducer_ = producer;
+        body_.clear();
+        sharedBody_.reset();
+        fileFd_ = -1;
+    }
+    // A complete response rendered beforehand (status line, headers and body, e.g. from a cache), sent as is
+    // in place of everything else. It must suit the request: no body for HEAD, no "Connection: close" on keep-alive
+    void setRawResponse(const std::shared_ptr<const std::string> &raw) { rawResponse_ = raw; }
+    const std::shared_ptr<const std::string> &rawResponse() const { return rawResponse_; }
+
+    size_t bodyLength() const
+    {
+        if (fileFd_ >= 0)
+            return fileCount_;
+        return sharedBody_ ? sharedBody_->size() : body_.size();
+    }
+    std::string &body() { return body_; }
+    const std::shared_ptr<const std::string> &sharedBody() const { return sharedBody_; }
+    bool hasFileBody() const { return fileFd_ >= 0; }
+    int fileFd() const { return fileFd_; }
+    off_t fileOffset() const { return fileOffset_; }
+    size_t fileCount() const { return fileCount_; }
+    const std::shared_ptr<const void> &fileHolder() const { return fileHolder_; }
+    const StreamProducer &streamProducer() const { return streamProducer_; }
+
+    // Append the status line, the headers, Content-Length, Connection and the blank line to output.
+    // keepAliveHeader: the request was HTTP/1.0 with keep-alive, which must be confirmed explicitly
+    void appendHeadersToBuffer(Buffer *output, bool keepAliveHeader) const;
+
+private:
+    StatusCode statusCode_;
+    bool closeConnection_;
+    Buffer headers_; // "Name: value\r\n" lines in the order they were added
+    std::string body_;
+    std::shared_ptr<const std::string> sharedBody_;
+    int fileFd_; // -1 unless the body is a file range
+    off_t fileOffset_;
+    size_t fileCount_;
+    std::shared_ptr<const void> fileHolder_;
+    StreamProducer streamProducer_;
+    std::shared_ptr<const std::string> rawResponse_;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "TcpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+/**
+ * HTTP/1.1 server on top of TcpServer
+ *
+ * Every connection gets an HttpContext as its context. Requests are parsed in place in the input buffer and
+ * handled one after the other as soon as they are complete, so pipelined requests are answered in order;
+ * the responses produced by one read are gathered in one output Buffer and sent together.
+ * Connections stay open per the keep-alive rules of HttpRequest::keepAlive().
+ *
+ * A streamed response (HttpResponse::setStreamBody) takes over the connection's high-water mark and
+ * write-complete callbacks while it lasts, to pace its producer (see HttpStreamWriter). Requests pipelined
+ * behind it are held in the input buffer and handled once the stream is finished.
+ **/
+class HttpServer : noncopyable
+{
+public:
+    using HttpCallback = std::function<void(const HttpRequest &, HttpResponse *)>;
+
+    HttpServer(EventLoop *loop,
+               const InetAddress &listenAddr,
+               const std::string &name,
+               TcpServer::Option option = TcpServer::kNoReusePort);
+
+    EventLoop *getLoop() const { return loop_; }
+    // The underlying server, for tuning (idle timeout, edge-triggered mode, ...) before start()
+    TcpServer &tcpServer() { return server_; }
+
+    // Called in the io loop for every request; a response left at kUnknown is sent as 200 OK
+    void setHttpCallback(const HttpCallback &cb) { httpCallback_ = cb; }
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+    // Requests whose header or body exceeds these limits are answered with 431 / 413 and the connection is closed
+    void setMaxHeaderBytes(size_t bytes) { maxHeaderBytes_ = bytes; }
+    void setMaxBodyBytes(size_t bytes) { maxBodyBytes_ = bytes; }
+    // Streamed bodies pause while more than this is waiting in a connection's output
+    void setStreamHighWaterMark(size_t bytes) { streamHighWaterMark_ = bytes; }
+
+    void start();
+
+private:
+    static const size_t kMaxCopiedBody = 4096; // Larger bodies are queued after the headers instead of copied into them
+    static const size_t kDefaultStreamHighWaterMark = 256 * 1024;
+
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    // Handle one request, returns true if the connection must be closed after it
+    bool onRequest(const TcpConnectionPtr &conn, const HttpRequest &req, Buffer *output);
+    void sendError(const TcpConnectionPtr &conn, HttpResponse::StatusCode status, Buffer *output);
+    void startStream(const TcpConnectionPtr &conn, const HttpResponse::StreamProducer &producer, bool close);
+    void onStreamFinished(const TcpConnectionPtr &conn, bool close);
+
+    EventLoop *loop_;
+    TcpServer server_;
+    HttpCallback httpCallback_;
+    size_t maxHeaderBytes_;
+    size_t maxBodyBytes_;
+    size_t streamHighWaterMark_;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stddef.h>
+#include <functional>
+#include <memory>
+#include <string_view>
+
+#include "noncopyable.h"
+#include "Buffer.h"
+#include "Callbacks.h"
+#include "HttpResponse.h"
+
+class EventLoop;
+
+/**
+ * Body of a streamed HTTP response, pulled from a producer as the connection drains
+ *
+ * The producer (HttpResponse::setStreamBody) is called in the io loop, once per loop iteration, and writes
+ * the next piece of the body with write() or ends it with finish(). Each write() becomes one chunk
+ * ("<hex size>\r\n<data>\r\n", finish() sends the "0\r\n\r\n" terminator) unless the connection closes after the
+ * response, in which case the bytes go out as they are.
+ *
+ * A producer with nothing ready yet (e.g. waiting on a slower upstream) just returns without writing: it is
+ * then not called again until notify() is, from any thread, once data is available.
+ *
+ * Backpressure: the producer is paused while the connection's pending output is at or above HttpServer's
+ * stream high-water mark, whether a write crossed it (HighWaterMarkCallback) or earlier responses had filled
+ * the output before the producer's turn, and the WriteCompleteCallback that follows when the output is
+ * drained resumes it. A download to a slow client thus holds at most the high-water mark plus one chunk.
+ * If the connection goes away the producer is simply not called again.
+ **/
+class HttpStreamWriter : noncopyable, public std::enable_shared_from_this<HttpStreamWriter>
+{
+public:
+    using Producer = HttpResponse::StreamProducer;
+    using FinishCallback = std::function<void(const TcpConnectionPtr &)>;
+
+    // chunked: frame the writes with chunked transfer coding. highWaterMark: pending output that pauses the producer
+    HttpStreamWriter(const TcpConnectionPtr &conn, const Producer &producer, bool chunked, size_t highWaterMark);
+
+    // Send the next piece of the body, copied once. Only call it in the loop thread, normally from the producer.
+    // Empty writes are dropped: a zero-size chunk would end the body
+    void write(const void *data, size_t len);
+    void write(std::string_view data) { write(data.data(), data.size()); }
+    // End the body, the producer is not called again
+    void finish();
+    // Call the producer again after it returned without writing. Thread safe: the source of the data keeps
+    // the writer (shared_from_this()) and notifies it when more is ready
+    void notify();
+
+    bool finished() const { return finished_; }
+    size_t bytesWritten() const { return bytesWritten_; }
+    // Null once the connection is gone
+    TcpConnectionPtr connection() const { return conn_.lock(); }
+
+    // Driven by HttpServer: called once the stream is over and the terminator is queued
+    void setFinishCallback(const FinishCallback &cb) { finishCallback_ = cb; }
+    void start() { schedule(); }
+    // High-water mark crossed / output drained
+    void pause() { paused_ = true; }
+    void resume();
+
+private:
+    // One producer call per loop iteration, so other connections of the loop are served in between
+    // and the high-water mark callback, queued by a write, runs before the next call
+    void schedule();
+    void produce();
+    void notifyInLoop();
+
+    EventLoop *loop_;
+    std::weak_ptr<TcpConnection> conn_;
+    Producer producer_;
+    FinishCallback finishCallback_;
+    // A chunk with its framing, assembled so it leaves with one write. It keeps its storage across chunks, but
+    // what the socket does not take at once is copied into the connection's output queue, which allocates
+    Buffer frame_;
+    bool chunked_;
+    size_t highWaterMark_;
+    bool paused_;
+    bool scheduled_;
+    bool waiting_;  // The last producer call wrote nothing, wait for notify()
+    bool notified_; // notify() came during the producer call
+    bool finished_;
+    size_t bytesWritten_;
+};
+
+using HttpStreamWriterPtr = std::shared_ptr<HttpStreamWriter>;
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+
+#include "noncopyable.h"
+#include "TimerId.h"
+#include "TcpConnection.h"
+
+class EventLoop;
+
+/**
+ * Per-loop idle connection reaper, a circular buffer of idleSeconds + 1 buckets advanced once per second
+ *
+ * Every bucket is an intrusive list threaded through the TcpConnection objects themselves, so moving a
+ * connection to the current bucket on activity is a few pointer writes and never allocates.
+ * When the cursor comes back to a bucket, the connections still in it have been idle for idleSeconds and are force-closed.
+ * Halfway there, the connections of a bucket are asked to give back their drained buffer memory.
+ * All methods must be called in the loop thread, except the constructor.
+ **/
+class IdleReaper : noncopyable
+{
+public:
+    IdleReaper(EventLoop *loop, int idleSeconds);
+    ~IdleReaper();
+
+    // Start turning the wheel
+    void start();
+
+    // Record activity on conn (hot path: called on every read)
+    void touch(TcpConnection *conn)
+    {
+        if (conn->idleBucket_ == cursor_)
+        {
+            return;
+        }
+        remove(conn);
+        link(conn, cursor_);
+    }
+
+    // Stop tracking conn
+    void remove(TcpConnection *conn);
+
+private:
+    void link(TcpConnection *conn, int bucket);
+    void onTick();
+
+    EventLoop *loop_;
+    std::vector<TcpConnection *> buckets_; // Heads of the bucket lists
+    int cursor_;                           // Bucket collecting activity of the current second
+    TimerId timerId_;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <linux/io_uring.h>
+
+#include "Poller.h"
+#include "Timestamp.h"
+
+/**
+ * Usage of io_uring as a readiness poller:
+ * 1. io_uring_setup + mmap of the submission/completion rings
+ * 2. IORING_OP_POLL_ADD / IORING_OP_POLL_REMOVE replace epoll_ctl add/mod/del
+ * 3. A single io_uring_enter submits every queued request and waits for completions
+ *
+ * Poll requests are one-shot, so a fired channel is re-armed on the next poll() call,
+ * which keeps the level-triggered semantics Channel and TcpConnection rely on.
+ * All interest changes made while handling events are batched into that same io_uring_enter.
+ **/
+
+class Channel;
+
+class IoUringPoller : public Poller
+{
+public:
+    IoUringPoller(EventLoop *loop);
+    ~IoUringPoller() override;
+
+    // Whether the running kernel provides the io_uring features this poller needs
+    static bool isSupported();
+
+    // Override the abstract method of base class Poller
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    void updateChannel(Channel *channel) override;
+    void removeChannel(Channel *channel) override;
+
+private:
+    static const unsigned kRingEntries = 1024;
+
+    // Poll request state of one registered fd
+    struct Registration
+    {
+        Channel *channel;
+        uint32_t generation; // Renewed on every (re-)arm, so completions of stale requests are ignored
+        bool armed;          // A poll request is in flight for this fd
+    };
+
+    // Fill active connections
+    void fillActiveChannels(ChannelList *activeChannels);
+    // Queue a poll request for the current interest set of the channel
+    void armPoll(Registration &reg);
+    // Queue the removal of the in-flight poll request of the channel
+    void cancelPoll(Registration &reg);
+    // Get a free submission queue entry, flushing the ring to the kernel if it is full
+    io_uring_sqe *getSqe();
+    // Submit queued entries and optionally wait for at least one completion
+    int enter(unsigned minComplete, int timeoutMs);
+
+    static uint64_t makeUserData(int fd, uint32_t generation);
+
+    int ringFd_;
+    io_uring_params params_;
+
+    // Mapped rings
+    void *sqRing_;
+    void *cqRing_;
+    size_t sqRingSize_;
+    size_t cqRingSize_;
+    io_uring_sqe *sqes_;
+    size_t sqesSize_;
+
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned *sqMask_;
+    unsigned *sqArray_;
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned *cqMask_;
+    io_uring_cqe *cqes_;
+
+    unsigned sqPending_; // Entries written to the SQ ring but not yet submitted
+
+    std::unordered_map<int, Registration> registrations_;
+    // Source of all generations, poller-wide: a reused fd number must not meet a generation of its previous owner,
+    // whose cancelled requests may still complete
+    uint32_t nextGeneration_;
+    std::vector<int> rearmFds_; // Fds whose one-shot poll fired during the last poll()
+};
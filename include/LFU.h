@@ -289,14 +289,17 @@ void RLfuCache<Key, Value>::handleOverMaxAverageNum()
         // Remove from current frequency list
         removeFromFreqList(node);
 
-        // Decrease frequency
+        // Decrease frequency, and the total with it so the average drops back under the limit
+        int oldFreq = node->freq;
         node->freq -= maxAverageNum_ / 2;
         if (node->freq < 1) node->freq = 1;
+        curTotalNum_ -= oldFreq - node->freq;
 
         // Add to new frequency list
         addToFreqList(node);
     }
 
+    curAverageNum_ = curTotalNum_ / nodeMap_.size();
     // Update minimum frequency
     updateMinFreq();
 }
@@ -323,8 +326,8 @@ class RHashLfuCache
 {
 public:
     RHashLfuCache(size_t capacity, int sliceNum, int maxAverageNum = 10)
-        : sliceNum_(sliceNum > 0 ? sliceNum : std::thread::hardware_concurrency())
-        , capacity_(capacity)
+        : capacity_(capacity)
+        , sliceNum_(sliceNum > 0 ? sliceNum : std::thread::hardware_concurrency())
     {
         size_t sliceSize = std::ceil(capacity_ / static_cast<double>(sliceNum_)); // Capacity of each lfu shard
         for (int i = 0; i < sliceNum_; ++i)
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "RICachePolicy.h"
+
+namespace RonaldCache
+{
+
+// Least recently used cache: a hash map into a doubly linked list kept in access order, O(1) put/get/remove.
+// A node owns its successor only, the link back is weak, so dropping the list frees every node
+template<typename Key, typename Value>
+class RLruCache : public RICachePolicy<Key, Value>
+{
+public:
+    explicit RLruCache(size_t capacity)
+        : capacity_(capacity)
+    {
+        head_ = std::make_shared<Node>();
+        tail_ = std::make_shared<Node>();
+        head_->next = tail_;
+        tail_->pre = head_;
+    }
+
+    ~RLruCache() override { unlinkAll(); }
+
+    void put(Key key, Value value) override
+    {
+        if (capacity_ == 0)
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        if (it != nodeMap_.end())
+        {
+            // Replace the value and mark it as most recently used
+            it->second->value = value;
+            moveToMostRecent(it->second);
+            return;
+        }
+
+        if (nodeMap_.size() >= capacity_)
+            evictLeastRecent();
+
+        NodePtr node = std::make_shared<Node>(key, value);
+        insertNode(node);
+        nodeMap_[key] = node;
+    }
+
+    // value is an output parameter
+    bool get(Key key, Value& value) override
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        if (it == nodeMap_.end())
+            return false;
+
+        moveToMostRecent(it->second);
+        value = it->second->value;
+        return true;
+    }
+
+    Value get(Key key) override
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    void remove(Key key)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = nodeMap_.find(key);
+        if (it != nodeMap_.end())
+        {
+            removeNode(it->second);
+            nodeMap_.erase(it);
+        }
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return nodeMap_.size();
+    }
+
+    // Clear cache and reclaim resources
+    void purge()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        nodeMap_.clear();
+        unlinkAll();
+    }
+
+private:
+    struct Node
+    {
+        Key key;
+        Value value;
+        std::weak_ptr<Node> pre; // Weak, a strong back link would make every pair of neighbours a cycle
+        std::shared_ptr<Node> next;
+
+        Node() {}
+        Node(Key k, Value v)
+            : key(k), value(v) {}
+    };
+
+    using NodePtr = std::shared_ptr<Node>;
+    using NodeMap = std::unordered_map<Key, NodePtr>;
+
+    void moveToMostRecent(NodePtr node)
+    {
+        removeNode(node);
+        insertNode(node);
+    }
+
+    void removeNode(NodePtr node)
+    {
+        NodePtr pre = node->pre.lock();
+        pre->next = node->next;
+        node->next->pre = pre;
+        node->pre.reset();
+        node->next = nullptr;
+    }
+
+    // Most recently used nodes are kept at the tail
+    void insertNode(NodePtr node)
+    {
+        NodePtr last = tail_->pre.lock();
+        node->next = tail_;
+        node->pre = last;
+        last->next = node;
+        tail_->pre = node;
+    }
+
+    // Drop the nodes one at a time: releasing the head of the chain would free it recursively, one frame per node
+    void unlinkAll()
+    {
+        NodePtr node = head_->next;
+        head_->next = tail_;
+        tail_->pre = head_;
+        while (node != tail_)
+        {
+            NodePtr next = node->next;
+            node->next = nullptr;
+            node = next;
+        }
+    }
+
+    void evictLeastRecent()
+    {
+        NodePtr node = head_->next;
+        removeNode(node);
+        nodeMap_.erase(node->key);
+    }
+
+private:
+    size_t     capacity_; // Cache capacity
+    NodeMap    nodeMap_;  // Mapping from key to cache node
+    std::mutex mutex_;    // Mutex for synchronization
+    NodePtr    head_;     // Dummy head node, its next is the least recently used
+    NodePtr    tail_;     // Dummy tail node
+};
+
+// Sharded by key hash like RHashLfuCache, every shard with its own lock, so threads looking up different
+// keys rarely contend. The capacity is split evenly, recency is tracked per shard
+template<typename Key, typename Value>
+class RHashLruCache
+{
+public:
+    RHashLruCache(size_t capacity, int sliceNum)
+        : capacity_(capacity)
+        , sliceNum_(sliceNum > 0 ? sliceNum : std::thread::hardware_concurrency())
+    {
+        size_t sliceSize = std::ceil(capacity_ / static_cast<double>(sliceNum_)); // Capacity of each lru shard
+        for (int i = 0; i < sliceNum_; ++i)
+        {
+            lruSliceCaches_.emplace_back(new RLruCache<Key, Value>(sliceSize));
+        }
+    }
+
+    void put(Key key, Value value)
+    {
+        // Find the corresponding lru shard according to the key
+        size_t sliceIndex = Hash(key) % sliceNum_;
+        lruSliceCaches_[sliceIndex]->put(key, value);
+    }
+
+    bool get(Key key, Value& value)
+    {
+        size_t sliceIndex = Hash(key) % sliceNum_;
+        return lruSliceCaches_[sliceIndex]->get(key, value);
+    }
+
+    Value get(Key key)
+    {
+        Value value{};
+        get(key, value);
+        return value;
+    }
+
+    void remove(Key key)
+    {
+        size_t sliceIndex = Hash(key) % sliceNum_;
+        lruSliceCaches_[sliceIndex]->remove(key);
+    }
+
+    // Clear cache
+    void purge()
+    {
+        for (auto& lruSliceCache : lruSliceCaches_)
+        {
+            lruSliceCache->purge();
+        }
+    }
+
+private:
+    // Calculate the corresponding hash value for the key
+    size_t Hash(Key key)
+    {
+        std::hash<Key> hashFunc;
+        return hashFunc(key);
+    }
+
+private:
+    size_t capacity_; // Total cache capacity
+    int sliceNum_; // Number of cache shards
+    std::vector<std::unique_ptr<RLruCache<Key, Value>>> lruSliceCaches_; // Container for lru cache shards
+};
+
+} // namespace RonaldCache
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+#include "noncopyable.h"
+
+/**
+ * Lock-free multi-producer single-consumer queue (Dmitry Vyukov's algorithm)
+ * push() may be called from any thread; pop() must only be called from the single consumer thread.
+ *
+ * The queue always keeps one node that has already been consumed (the stub). Producers only touch head_,
+ * the consumer only touches tail_, so a push is a single atomic exchange plus a release store.
+ *
+ * It is not intrusive: every push() allocates a node holding the value and pop() frees it. Recycling nodes
+ * would need a free list the consumer pushes to and every producer pops from, an ABA-prone multi-consumer
+ * stack, for a malloc that thread caches already serve without a lock.
+ **/
+template <typename T>
+class MpscQueue : noncopyable
+{
+public:
+    MpscQueue()
+        : head_(new Node())
+        , tail_(head_.load(std::memory_order_relaxed))
+    {
+    }
+
+    ~MpscQueue()
+    {
+        T value;
+        while (pop(value))
+        {
+        }
+        delete tail_;
+    }
+
+    // Thread safe
+    void push(T value)
+    {
+        Node *node = new Node(std::move(value)); // One allocation per push, freed by the pop() that moves past it
+        Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+        // Between the exchange and this store the node is invisible to the consumer, pop() reports empty meanwhile
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // Consumer thread only. Returns false when the queue is empty
+    bool pop(T &value)
+    {
+        Node *tail = tail_;
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr)
+        {
+            return false;
+        }
+        value = std::move(next->value);
+        tail_ = next; // next becomes the new stub
+        delete tail;
+        return true;
+    }
+
+    // Consumer thread only. Pops every element that was fully pushed before the call, but none pushed
+    // while func runs, so a callback that keeps re-queueing itself cannot starve the consumer
+    template <typename Func>
+    void consumeAll(Func &&func)
+    {
+        Node *last = head_.load(std::memory_order_acquire);
+        T value;
+        while (tail_ != last && pop(value))
+        {
+            func(value);
+        }
+    }
+
+private:
+    struct Node
+    {
+        Node() : next(nullptr) {}
+        explicit Node(T &&v) : next(nullptr), value(std::move(v)) {}
+
+        std::atomic<Node *> next;
+        T value;
+    };
+
+    std::atomic<Node *> head_; // Most recently pushed node, shared by producers
+    Node *tail_;               // Stub node, owned by the consumer
+};
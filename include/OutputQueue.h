@@ -0,0 +1,127 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+#include "noncopyable.h"
+#include "Buffer.h"
+
+/**
+ * Output queue of a TcpConnection, a list of slices flushed in order:
+ *
+ * | copied bytes (Buffer) | shared body (std::string) | copied bytes | file range | ...
+ *
+ * Small writes are copied and coalesced into the Buffer slice at the tail. Large bodies are only referenced,
+ * the queue keeps the shared_ptr until every byte has been written. Consecutive memory slices are flushed
+ * with one writev, file ranges with sendfile once they reach the head.
+ *
+ * With a zero-copy threshold set, referenced bodies at least that large are sent alone with sendmsg(MSG_ZEROCOPY).
+ * The kernel then reads them after sendmsg returns, so they stay pinned until the completion for that call
+ * is read from the socket error queue.
+ **/
+class OutputQueue : noncopyable
+{
+public:
+    using StringPtr = std::shared_ptr<const std::string>;
+    // Called as bytes of a file range are retrieved: (sent, total)
+    using ProgressCallback = std::function<void(size_t, size_t)>;
+
+    OutputQueue();
+
+    // Pending bytes, file ranges included
+    size_t readableBytes() const { return bytes_; }
+    bool empty() const { return slices_.empty(); }
+
+    // Copy [data, data+len) to the tail of the queue
+    void append(const char *data, size_t len);
+    // Take the readable bytes of buf without copying them, buf is left empty
+    void append(Buffer &&buf);
+    // Queue the body without copying it
+    void append(const StringPtr &str, size_t offset = 0);
+    // Queue count bytes of fd starting at offset. fd must stay open until they are written
+    void appendFile(int fd, off_t offset, size_t count, const ProgressCallback &progress = ProgressCallback());
+
+    // Write from the head of the queue: writev of up to kMaxIovecs memory slices, or sendfile if the head is a file range
+    // A file that ends before its range does fails with EIO
+    ssize_t writeFd(int fd, int *saveErrno);
+    // Send referenced bodies of at least threshold bytes with MSG_ZEROCOPY, 0 (default) disables it.
+    // SO_ZEROCOPY must be set on the socket
+    void setZeroCopyThreshold(size_t threshold) { zeroCopyThreshold_ = threshold; }
+    size_t zeroCopyThreshold() const { return zeroCopyThreshold_; }
+    // Bodies of zero-copy sends not completed yet
+    bool hasPinned() const { return !pinned_.empty(); }
+    // Read MSG_ZEROCOPY completions from the error queue of fd and release the bodies they cover.
+    // *copied is set if the kernel fell back to copying, in which case zero-copy only costs extra work
+    void handleZeroCopyCompletions(int fd, bool *copied);
+    // Hand over the pinned bodies, only once the socket is closed and the kernel no longer reads them
+    std::vector<StringPtr> takePinned();
+
+    // Drop len written bytes from the head
+    void retrieve(size_t len);
+    void retrieveAll();
+
+private:
+    static const int kMaxIovecs = 64;
+    static const size_t kMaxFileChunk = 1024 * 1024; // Bytes per sendfile call, keeps one transfer from hogging the loop
+
+    struct Slice
+    {
+        enum Type
+        {
+            kBuffer, // Copied bytes
+            kString, // Referenced body
+            kFile    // File range
+        };
+
+        explicit Slice(Type t)
+            : type(t)
+            , buffer(0)
+            , offset(0)
+            , fd(-1)
+            , fileOffset(0)
+            , fileRemaining(0)
+            , fileTotal(0)
+        {
+        }
+
+        const char *data() const { return type == kBuffer ? buffer.peek() : str->data() + offset; }
+        size_t size() const
+        {
+            switch (type)
+            {
+            case kBuffer:
+                return buffer.readableBytes();
+            case kString:
+                return str->size() - offset;
+            default:
+                return fileRemaining;
+            }
+        }
+
+        Type type;
+        Buffer buffer;
+        StringPtr str;
+        size_t offset; // Bytes of str already written
+        int fd;
+        off_t fileOffset;
+        size_t fileRemaining;
+        size_t fileTotal;
+        ProgressCallback progress;
+    };
+
+    bool isZeroCopy(const Slice &slice) const
+    {
+        return slice.type == Slice::kString && zeroCopyThreshold_ > 0 && slice.size() >= zeroCopyThreshold_;
+    }
+
+    std::deque<Slice> slices_;
+    size_t bytes_;
+
+    size_t zeroCopyThreshold_;
+    uint32_t zeroCopyNextId_;                          // Id the kernel gives the next successful MSG_ZEROCOPY send
+    std::deque<std::pair<uint32_t, StringPtr>> pinned_; // Send id => body the kernel may still read
+};
@@ -15,6 +15,14 @@ class Poller
 public:
     using ChannelList = std::vector<Channel *>;
 
+    // IO multiplexing backend used by an EventLoop
+    enum Backend
+    {
+        kDefaultBackend, // Decided by environment variables, epoll otherwise
+        kEPollBackend,   // epoll_wait + epoll_ctl
+        kIoUringBackend, // io_uring poll requests submitted and reaped in batches
+    };
+
     Poller(EventLoop *loop);
     virtual ~Poller() = default;
 
@@ -28,6 +36,8 @@ public:
 
     // EventLoop can get the specific implementation of default IO multiplexing through this interface
     static Poller *newDefaultPoller(EventLoop *loop);
+    // Create the requested backend, falling back to epoll if it is not available on this kernel
+    static Poller *newPoller(EventLoop *loop, Backend backend);
 
 protected:
     // map's key: sockfd value: channel type that sockfd belongs to
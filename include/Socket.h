@@ -25,6 +25,8 @@ public:
     void setReuseAddr(bool on);
     void setReusePort(bool on);
     void setKeepAlive(bool on);
+    // Allow MSG_ZEROCOPY sends, returns false if the kernel does not support it (Linux < 4.14)
+    bool setZeroCopy(bool on);
 
 private:
     const int sockfd_;
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "noncopyable.h"
+#include "LRU.h"
+#include "LFU.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+/**
+ * Serves GET/HEAD requests from the files under a document root
+ *
+ * URL paths are percent-decoded and normalized ("." and ".." segments resolved) before being looked up,
+ * a path leaving the root is refused; a trailing '/' maps to index.html. Symbolic links are followed.
+ *
+ * Open descriptors and their stat results are kept in a sharded LRU keyed by the normalized path, so a hot file
+ * costs no open/fstat/close: its range is queued with TcpConnection::sendFile (through
+ * HttpResponse::setFileBody) and the cache entry rides along until the bytes have left, which keeps the
+ * descriptor valid even if the entry is evicted meanwhile. An entry is checked against the disk (inode,
+ * size, mtime) at most once per revalidate interval and reopened if the file changed.
+ *
+ * Responses carry ETag, Last-Modified and Accept-Ranges; If-None-Match / If-Modified-Since answer 304,
+ * a single "Range: bytes=" range answers 206 (honoring If-Range) or 416, multiple ranges get the whole file.
+ *
+ * Plain keep-alive GETs of small files skip even that: the complete 200 response, headers and body, is
+ * rendered once and kept in a sharded LFU keyed by path and ETag, and a hit is sent as a single write of the
+ * shared immutable string (HttpResponse::setRawResponse). A modified file gets a new ETag, so its stale
+ * rendering is never hit again and ages out.
+ **/
+class StaticFileHandler : noncopyable
+{
+public:
+    static const size_t kDefaultCacheEntries = 1024;
+    static const size_t kDefaultResponseCacheEntries = 256;
+    static const size_t kDefaultMaxCachedFileSize = 32 * 1024;
+
+    explicit StaticFileHandler(const std::string &root, size_t cacheEntries = kDefaultCacheEntries);
+    ~StaticFileHandler();
+
+    // Fill resp for req, may be called from any io loop. Bind it as the HttpServer::HttpCallback,
+    // or call it from one for the paths it should serve
+    void handle(const HttpRequest &req, HttpResponse *resp);
+
+    // Cached files are stat()ed again once this many seconds have passed since the last check, 0 checks every time
+    void setRevalidateInterval(double seconds) { revalidateMicroSeconds_ = static_cast<int64_t>(seconds * 1000 * 1000); }
+
+    // Keep up to entries rendered responses of files no larger than maxFileSize, 0 entries turns it off.
+    // Call it before the server starts
+    void setResponseCache(size_t entries, size_t maxFileSize);
+
+    const std::string &root() const { return root_; }
+
+private:
+    struct File;
+    using FilePtr = std::shared_ptr<const File>;
+    using RenderedPtr = std::shared_ptr<const std::string>;
+    using ResponseCache = RonaldCache::RHashLfuCache<std::string, RenderedPtr>;
+
+    // Cached or freshly opened file for a normalized path, status is 200 on success
+    HttpResponse::StatusCode lookup(const std::string &path, FilePtr *file);
+    HttpResponse::StatusCode openFile(const std::string &path, FilePtr *file);
+    // Whether the cached entry still describes the file on disk, rechecked once per revalidate interval
+    bool fresh(const File &file);
+    // Content-Type, validators and Accept-Ranges of a 200/206 response
+    static void addFileHeaders(HttpResponse *resp, const File &file);
+    // The whole 200 response for file, nullptr if it could not be read
+    static RenderedPtr renderResponse(const File &file);
+
+    std::string root_;
+    int64_t revalidateMicroSeconds_;
+    RonaldCache::RHashLruCache<std::string, FilePtr> cache_; // Sharded, every io loop looks files up in it
+    std::unique_ptr<ResponseCache> responseCache_;
+    size_t maxCachedFileSize_;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Delimiter search over [begin, end) for protocol parsing, every function returns nullptr if nothing matches
+ *
+ * findCRLF and findAny compare 16 (SSE2) or 32 (AVX2) bytes per step. The AVX2 versions are compiled with a
+ * target attribute and picked once at startup if the CPU has AVX2, so the library still runs on any x86-64;
+ * other architectures use the scalar versions. findChar and findEOL are memchr, which glibc already vectorizes
+ * with its own runtime dispatch.
+ **/
+namespace search
+{
+const char *findCRLF(const char *begin, const char *end);
+const char *findEOL(const char *begin, const char *end);
+const char *findChar(const char *begin, const char *end, char c);
+// First byte that is any of set[0, setSize)
+const char *findAny(const char *begin, const char *end, const char *set, size_t setSize);
+
+// The implementations behind the dispatch, for benchmarks. Unsupported ones fall back to the scalar version
+enum Impl
+{
+    kScalar,
+    kSse2,
+    kAvx2
+};
+Impl bestImpl();
+const char *findCRLF(Impl impl, const char *begin, const char *end);
+const char *findAny(Impl impl, const char *begin, const char *end, const char *set, size_t setSize);
+} // namespace search
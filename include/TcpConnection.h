@@ -3,16 +3,19 @@
 #include <memory>
 #include <string>
 #include <atomic>
+#include <any>
 
 #include "noncopyable.h"
 #include "InetAddress.h"
 #include "Callbacks.h"
 #include "Buffer.h"
+#include "OutputQueue.h"
 #include "Timestamp.h"
 
 class Channel;
 class EventLoop;
 class Socket;
+class IdleReaper;
 
 /**
  * TcpServer => Acceptor => A new user connection is obtained through the accept function to get connfd
@@ -36,12 +39,58 @@ public:
 
     bool connected() const { return state_ == kConnected; }
 
+    // Send referenced bodies of at least threshold bytes with MSG_ZEROCOPY, 0 disables. Turned off again
+    // when the kernel reports it had to copy anyway (e.g. loopback). Call before connectEstablished()
+    void setZeroCopyThreshold(size_t threshold);
+
+    // Register the socket with EPOLLET; reads and writes then drain until EAGAIN. Call before connectEstablished()
+    void setEdgeTriggered(bool on);
+
     // Send data
     void send(const std::string &buf);
-    void sendFile(int fileDescriptor, off_t offset, size_t count); 
+    // Take ownership of buf: nothing is copied when called from another thread
+    void send(std::string &&buf);
+    void send(const char *data, size_t len);
+    // Send the readable bytes of buf and leave it empty; from another thread its storage is swapped out rather than copied
+    void send(Buffer *buf);
+    // Send a body without copying it, the connection keeps a reference until it is written
+    void send(const std::shared_ptr<const std::string> &body);
+    // The header is copied, the body is referenced; both leave with a single writev
+    void send(const std::string &header, const std::shared_ptr<const std::string> &body);
+    // Send count bytes of the file from offset, after the data already queued. The file is pushed by sendfile
+    // as EPOLLOUT allows, at most 1 MiB per call; several ranges may be queued back to back.
+    // cb (optional) reports progress in the loop thread. fileDescriptor must stay open until the range completes
+    void sendFile(int fileDescriptor, off_t offset, size_t count, const SendFileCallback &cb = SendFileCallback());
     
+    // Forward everything received on this connection to dest with splice() through a pipe, without copying it
+    // into inputBuffer_/outputQueue_. Reading pauses while dest cannot take more. Both connections must belong to
+    // the same loop. When the peer half-closes, dest is shut down for writing once the pipe is drained, and this
+    // connection is closed as soon as it has been shut down for writing as well
+    void forwardTo(const TcpConnectionPtr &dest);
+
+    // Resume / stop watching the socket for input. Thread safe
+    void startRead();
+    void stopRead();
+    bool isReading() const { return reading_; }
+    // Stop reading once inputBuffer_ holds highWaterMark bytes after the message callback (0 disables, the default),
+    // resume when it is drained to half of it by consumeInput() or startRead(). Must exceed the largest message
+    void setInputHighWaterMark(size_t highWaterMark) { inputHighWaterMark_ = highWaterMark; }
+    // Bytes waiting in the output queue, only used in the loop thread
+    size_t outputBytes() const { return outputQueue_.readableBytes(); }
+    // Input received but not retrieved by the message callback yet, only used in the loop thread
+    Buffer *inputBuffer() { return &inputBuffer_; }
+    // Retrieve len bytes of input outside the message callback (e.g. after asynchronous processing). Thread safe
+    void consumeInput(size_t len);
+
+    // Per-connection state of the protocol layer (e.g. the HttpContext of HttpServer), only used in the loop thread
+    void setContext(const std::any &context) { context_ = context; }
+    const std::any &getContext() const { return context_; }
+    std::any *getMutableContext() { return &context_; }
+
     // Close half connection
     void shutdown();
+    // Close the connection without waiting for pending output to be sent
+    void forceClose();
 
     void setConnectionCallback(const ConnectionCallback &cb)
     { connectionCallback_ = cb; }
@@ -53,6 +102,8 @@ public:
     { closeCallback_ = cb; }
     void setHighWaterMarkCallback(const HighWaterMarkCallback &cb, size_t highWaterMark)
     { highWaterMarkCallback_ = cb; highWaterMark_ = highWaterMark; }
+    // Reaper of the owning loop that closes this connection once it stays idle. Call before connectEstablished()
+    void setIdleReaper(IdleReaper *reaper) { idleReaper_ = reaper; }
 
     // Connection established
     void connectEstablished();
@@ -60,6 +111,13 @@ public:
     void connectDestroyed();
 
 private:
+    friend class IdleReaper;
+
+    static const size_t kMinSharedBytes = 4096; // Owned strings at least this large are queued by reference instead of copied
+    static const int kZeroCopyLingerSeconds = 30; // How long a destroyed connection waits for its zero-copy completions before resetting
+    static constexpr double kZeroCopyPollSeconds = 0.1;
+    static const size_t kMaxWriteBytesPerCall = 1024 * 1024; // Written per send or EPOLLOUT before the rest waits, so a fast reader cannot starve the loop
+
     enum StateE
     {
         kDisconnected, // Already disconnected
@@ -75,12 +133,36 @@ private:
     void handleError();
 
     void sendInLoop(const void *data, size_t len);
+    void sendStringInLoop(std::string &buf);
+    void sendBufferInLoop(Buffer &buf);
+    void sendSharedInLoop(const std::string &header, const std::shared_ptr<const std::string> &body);
     void shutdownInLoop();
-    void sendFileInLoop(int fileDescriptor, off_t offset, size_t count);
+    void forceCloseInLoop();
+    void sendQueuedInLoop(size_t oldLen);
+    void startReadInLoop();
+    void stopReadInLoop();
+    void consumeInputInLoop(size_t len);
+    // Enable EPOLLIN only if the application reads, the input is below its high-water mark and no forwarding pipe is full
+    void updateReading();
+    void handleResumedRead();
+    // After connectDestroyed: read zero-copy completions until no body is pinned, reset the socket at the deadline
+    void reapZeroCopyCompletions();
+    // Called by the IdleReaper once the connection has been quiet for a while: give back drained input capacity
+    void releaseIdleBuffers();
+    bool inputAboveHighWaterMark() const { return inputHighWaterMark_ > 0 && inputBuffer_.readableBytes() >= inputHighWaterMark_; }
+    void forwardToInLoop(const TcpConnectionPtr &dest);
+    // Source side of forwardTo: socket => pipe, and pipe => destination socket
+    void handleForwardRead();
+    void drainForwardPipe();
+    // Close a source that has passed its EOF on and whose write side is shut down, true if it was closed
+    bool closeIfForwardDone();
+    void sendFileInLoop(int fileDescriptor, off_t offset, size_t count, const SendFileCallback &cb);
+    void handleSendFileProgress(const SendFileCallback &cb, size_t sent, size_t total);
     EventLoop *loop_; // Here is baseloop or subloop determined by the number of threads created in TcpServer. If it is multi-Reactor, this loop_ points to subloop. If it is single-Reactor, this loop_ points to baseloop
     const std::string name_;
     std::atomic_int state_;
-    bool reading_;//Whether the connection is listening for read events
+    bool reading_;//Whether the application wants read events (startRead/stopRead)
+    bool inputPaused_; // Reading paused at the input high-water mark
 
     // Socket Channel here is similar to Acceptor. Acceptor => mainloop TcpConnection => subloop
     std::unique_ptr<Socket> socket_;
@@ -96,8 +178,30 @@ private:
     HighWaterMarkCallback highWaterMarkCallback_; // High water mark callback
     CloseCallback closeCallback_; // Callback for closing connection
     size_t highWaterMark_; // High water mark threshold
+    size_t inputHighWaterMark_; // Input high water mark, 0 disables
 
     // Data buffer
     Buffer inputBuffer_;    // Buffer for receiving data
-    Buffer outputBuffer_;   // Buffer for sending data. User sends to outputBuffer_
+    OutputQueue outputQueue_; // Data waiting to be sent: copied bytes, referenced bodies and file ranges
+
+    std::any context_; // Protocol state set by the server built on top
+
+    // forwardTo() state of the source connection
+    struct ForwardPipe
+    {
+        TcpConnectionPtr dest;
+        int fds[2];      // pipe: fds[1] <= this socket, fds[0] => dest socket
+        size_t capacity; // Pipe size
+        size_t bytes;    // Bytes in the pipe
+        bool eof;        // The peer half-closed, shut dest down for writing once the pipe is drained
+    };
+    std::unique_ptr<ForwardPipe> forward_;
+    std::weak_ptr<TcpConnection> forwardSource_; // Connection forwarding into this one
+
+    // Idle tracking, the connection is linked into a bucket of its loop's IdleReaper
+    IdleReaper *idleReaper_;
+    TcpConnection *idlePrev_;
+    TcpConnection *idleNext_;
+    int idleBucket_; // -1 when not linked
+    int64_t zeroCopyDeadline_; // Microseconds since epoch, when a destroyed connection stops waiting for completions
 };
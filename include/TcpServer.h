@@ -8,6 +8,7 @@
 #include <string>
 #include <memory>
 #include <atomic>
+#include <mutex>
 #include <unordered_map>
 
 #include "EventLoop.h"
@@ -18,6 +19,7 @@
 #include "Callbacks.h"
 #include "TcpConnection.h"
 #include "Buffer.h"
+#include "IdleReaper.h"
 
 // Class used for server programming
 class TcpServer
@@ -29,6 +31,7 @@ public:
     {
         kNoReusePort,// Do not allow reuse of local port
         kReusePort,// Allow reuse of local port
+        kReusePortPerLoop,// Every io loop listens on its own SO_REUSEPORT socket and accepts its own connections
     };
 
     TcpServer(EventLoop *loop,
@@ -44,6 +47,16 @@ public:
 
     // Set the number of underlying subloops
     void setThreadNum(int numThreads);
+    // Select the IO multiplexing backend (epoll or io_uring) of the subloops, must be called before start()
+    void setPollerBackend(Poller::Backend backend);
+    // Register new connections edge-triggered (EPOLLET), suited to bulk transfers; level-triggered by default
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    // Send large referenced bodies (see TcpConnection::setZeroCopyThreshold) with MSG_ZEROCOPY, 0 disables
+    void setZeroCopyThreshold(size_t bytes) { zeroCopyThreshold_ = bytes; }
+    // Input high-water mark of new connections (see TcpConnection::setInputHighWaterMark), 0 disables
+    void setInputHighWaterMark(size_t bytes) { inputHighWaterMark_ = bytes; }
+    // Force-close connections that neither read nor write for about this many seconds (0 disables), must be called before start()
+    void setIdleTimeout(int seconds) { idleTimeout_ = seconds; }
     /**
      * If not listening, start the server (listen).
      * Multiple calls have no side effects.
@@ -53,17 +66,24 @@ public:
 
 private:
     void newConnection(int sockfd, const InetAddress &peerAddr);
+    // Create the connection on ioLoop; called in ioLoop itself by the per-loop acceptors
+    void newConnectionInLoop(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr);
     void removeConnection(const TcpConnectionPtr &conn);
     void removeConnectionInLoop(const TcpConnectionPtr &conn);
 
     using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+    using AcceptorMap = std::unordered_map<EventLoop *, std::unique_ptr<Acceptor>>;
+    using IdleReaperMap = std::unordered_map<EventLoop *, std::unique_ptr<IdleReaper>>;
 
     EventLoop *loop_; // baseloop user-defined loop
 
     const std::string ipPort_;
     const std::string name_;
+    const InetAddress listenAddr_;
+    const Option option_;
 
-    std::unique_ptr<Acceptor> acceptor_; // Runs in mainloop, task is to listen for new connection events
+    std::unique_ptr<Acceptor> acceptor_; // Runs in mainloop, task is to listen for new connection events. Null in kReusePortPerLoop mode
+    AcceptorMap loopAcceptors_;          // kReusePortPerLoop mode: one acceptor per io loop, created in start()
 
     std::shared_ptr<EventLoopThreadPool> threadPool_; // one loop per thread
 
@@ -74,6 +94,12 @@ private:
     ThreadInitCallback threadInitCallback_; // Callback for loop thread initialization
     int numThreads_;// Number of threads in the thread pool
     std::atomic_int started_;
-    int nextConnId_;
+    std::atomic_int nextConnId_;
+    bool edgeTriggered_; // Whether new connections use edge-triggered mode
+    int idleTimeout_;    // Idle timeout in seconds, 0 disables the reaper
+    size_t zeroCopyThreshold_; // MSG_ZEROCOPY threshold of new connections, 0 disables
+    size_t inputHighWaterMark_; // Input high-water mark of new connections, 0 disables
+    IdleReaperMap idleReapers_; // One reaper per io loop, created in start() and read-only afterwards
+    std::mutex connectionsMutex_; // Connections are added by the accepting loop and removed by their own io loops
     ConnectionMap connections_; // Store all connections
 };
\ No newline at end of file
@@ -4,10 +4,14 @@
 #include "noncopyable.h"
 #include "Timestamp.h"
 #include <functional>
+#include <atomic>
+
+class TimerQueue;
 
 /**
  * Timer is used to describe a timer
  * Timer callback function, next timeout moment, time interval for repeating timers, etc.
+ * Timers are owned and recycled by TimerQueue, which links them into its timing wheel slots
  */
 class Timer : noncopyable
 {
@@ -15,10 +19,15 @@ public:
     using TimerCallback = std::function<void()>;
 
     Timer(TimerCallback cb, Timestamp when, double interval)
-        : callback_(move(cb)),
+        : callback_(std::move(cb)),
           expiration_(when),
           interval_(interval),
-          repeat_(interval > 0.0) // Set to 0 for one-time timer
+          repeat_(interval > 0.0), // Set to 0 for one-time timer
+          sequence_(++s_numCreated_),
+          prev_(nullptr),
+          next_(nullptr),
+          slot_(nullptr),
+          canceled_(false)
     {
     }
 
@@ -29,15 +38,30 @@ public:
 
     Timestamp expiration() const  { return expiration_; }
     bool repeat() const { return repeat_; }
+    int64_t sequence() const { return sequence_; }
 
     // Restart timer (if it's a non-repeating event, set expiration time to 0)
     void restart(Timestamp now);
 
 private:
-    const TimerCallback callback_;  // Timer callback function
-    Timestamp expiration_;          // Next timeout moment
-    const double interval_;         // Timeout interval, if it's a one-time timer, this value is 0
-    const bool repeat_;             // Whether to repeat (false means it's a one-time timer)
+    friend class TimerQueue;
+
+    // Give a recycled timer a new task and a new sequence number
+    void reset(TimerCallback cb, Timestamp when, double interval);
+
+    TimerCallback callback_;  // Timer callback function
+    Timestamp expiration_;    // Next timeout moment
+    double interval_;         // Timeout interval, if it's a one-time timer, this value is 0
+    bool repeat_;             // Whether to repeat (false means it's a one-time timer)
+    int64_t sequence_;        // Unique id of the current task, 0 while the timer sits in the free list
+
+    // Intrusive links of the timing wheel slot the timer is in (maintained by TimerQueue)
+    Timer *prev_;
+    Timer *next_;
+    Timer **slot_;            // Head of that slot, nullptr when the timer is not in the wheel
+    bool canceled_;           // Cancelled while its expired batch is being run, or before its queued add ran
+
+    static std::atomic<int64_t> s_numCreated_;
 };
 
-#endif // TIMER_H
\ No newline at end of file
+#endif // TIMER_H
@@ -0,0 +1,34 @@
+#ifndef TIMER_ID_H
+#define TIMER_ID_H
+
+#include <cstdint>
+
+class Timer;
+
+/**
+ * Handle of a timer returned by EventLoop::runAt/runAfter/runEvery, used to cancel it
+ * The sequence number tells a live timer apart from a recycled Timer object at the same address
+ */
+class TimerId
+{
+public:
+    TimerId()
+        : timer_(nullptr),
+          sequence_(0)
+    {
+    }
+
+    TimerId(Timer *timer, int64_t sequence)
+        : timer_(timer),
+          sequence_(sequence)
+    {
+    }
+
+    friend class TimerQueue;
+
+private:
+    Timer *timer_;
+    int64_t sequence_;
+};
+
+#endif // TIMER_ID_H
@@ -3,14 +3,24 @@
 
 #include "Timestamp.h"
 #include "Channel.h"
+#include "TimerId.h"
 
 #include <vector>
-#include <set>
+#include <cstdint>
 
 class EventLoop;
 class Timer;
 
-class TimerQueue
+/**
+ * Hierarchical timing wheel driven by one timerfd
+ *
+ * | near: 256 slots x 1ms | level 0: 64 slots x 256ms | level 1: 64 slots x 16.4s | level 2: 64 slots x 17.5min |
+ *
+ * Timers live in intrusive lists, so insert and cancel are O(1). Timers of an upper level are cascaded
+ * into the lower levels when the near wheel wraps around. timerfd is only re-armed when the earliest
+ * tick that has work changes, at most once per processed batch.
+ */
+class TimerQueue : noncopyable
 {
 public:
     using TimerCallback = std::function<void()>;
@@ -19,40 +29,79 @@ public:
     ~TimerQueue();
 
     // Insert timer (callback function, expiration time, whether to repeat)
-    void addTimer(TimerCallback cb,
-                  Timestamp when,
-                  double interval);
-    
+    // Thread safe
+    TimerId addTimer(TimerCallback cb,
+                     Timestamp when,
+                     double interval);
+
+    // Cancel timer, no effect if a one-shot timer has already run
+    // Thread safe
+    void cancel(TimerId timerId);
+
 private:
-    using Entry = std::pair<Timestamp, Timer*>; // Use timestamp as key to get timer
-    using TimerList = std::set<Entry>;          // Underlying implementation uses red-black tree, automatically sorted by timestamp
+    static const int64_t kTickMicroSeconds = 1000; // Resolution of the near wheel
+    static const int kNearBits = 8;
+    static const int kNearSize = 1 << kNearBits;
+    static const int kNearMask = kNearSize - 1;
+    static const int kLevelBits = 6;
+    static const int kLevelSize = 1 << kLevelBits;
+    static const int kLevelMask = kLevelSize - 1;
+    static const int kLevels = 3;
+    static const int64_t kMaxDelta = 1LL << (kNearBits + kLevels * kLevelBits); // Farther timers are parked in the top level
 
     // Add timer in this loop
-    // Thread safe
     void addTimerInLoop(Timer* timer);
+    void cancelInLoop(TimerId timerId);
 
     // Function triggered by timer read event
     void handleRead();
 
     // Reset timerfd_
     void resetTimerfd(int timerfd_, Timestamp expiration);
-    
+
     // Remove all expired timers
-    // 1. Get expired timers
-    // 2. Reset these timers (destroy or repeat timer tasks)
-    std::vector<Entry> getExpired(Timestamp now);
-    void reset(const std::vector<Entry>& expired, Timestamp now);
+    // 1. Get expired timers (advance the wheel up to now, cascading upper levels on the way)
+    // 2. Reset these timers (destroy or repeat timer tasks), then re-arm timerfd once for the whole batch
+    void getExpired(Timestamp now);
+    void reset(Timestamp now);
 
-    // Internal method to insert timer
-    bool insert(Timer* timer);
+    // Internal method to insert timer into the slot matching its expiration
+    void insert(Timer* timer);
+    void link(Timer* timer, Timer** slot);
+    void unlink(Timer* timer);
+    // Re-insert every timer of an upper level slot relative to the current tick
+    void cascade(int level, int index);
+    // First non-empty near slot in [from, to), -1 if none
+    int findNearSlot(int from, int to) const;
+    // First tick at or after tick_ whose near slot is non-empty, or the next cascade point
+    int64_t nextNearTick() const;
+    // Arm timerfd_ for the earliest tick that has work, only if it changed
+    void rearm();
+
+    int64_t tickOf(Timestamp when) const;
+    Timestamp timeOfTick(int64_t tick) const;
+
+    // Timer objects are recycled through a free list owned by the loop thread
+    Timer* newTimer(TimerCallback cb, Timestamp when, double interval);
+    void recycle(Timer* timer);
 
     EventLoop* loop_;           // The EventLoop it belongs to
     const int timerfd_;         // timerfd is the timer interface provided by Linux
     Channel timerfdChannel_;    // Encapsulates timerfd_ file descriptor
-    // Timer list sorted by expiration
-    TimerList timers_;          // Timer queue (internal implementation is red-black tree)
+
+    Timer* near_[kNearSize];                   // Timers due within the next 256 ticks
+    uint64_t nearBitmap_[kNearSize / 64];      // Non-empty near slots
+    Timer* levels_[kLevels][kLevelSize];       // Upper levels, cascaded down as the wheel turns
+    size_t upperCount_;                        // Number of timers in the upper levels
+
+    const int64_t startMicroSeconds_;          // Time of tick 0
+    int64_t tick_;                             // Next tick to be processed
+    int64_t armedTick_;                        // Tick timerfd_ is armed for, -1 when disarmed
+
+    std::vector<Timer*> expired_;              // Batch being run, reused across ticks
+    Timer* freeList_;
 
     bool callingExpiredTimers_; // Indicates that expired timers are being retrieved
 };
 
-#endif // TIMER_QUEUE_H
\ No newline at end of file
+#endif // TIMER_QUEUE_H
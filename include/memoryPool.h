@@ -11,6 +11,9 @@ namespace memoryPool
 #define MEMORY_POOL_NUM 64
 #define SLOT_BASE_SIZE 8
 #define MAX_SLOT_SIZE 512
+#define CHUNK_CLASS_NUM 3 // 4K, 16K, 64K
+#define MIN_CHUNK_SIZE 4096
+#define MAX_CHUNK_SIZE 65536
 
 
 /* The slot size of a specific memory pool cannot be determined, because each memory pool has different slot sizes (multiples of 8)
@@ -46,6 +49,56 @@ private:
 };
 
 
+/* Size-classed pool for buffers between MAX_SLOT_SIZE and MAX_CHUNK_SIZE, rounded up to 4K, 16K or 64K chunks.
+Every thread (so every EventLoop) keeps a bounded cache of free chunks per class and only takes the
+lock of the shared free list to move a batch in or out, so connection churn stays off the global allocator.
+Unlike the slot pools it needs no initialization. A chunk may be freed by another thread than the one that allocated it */
+class ChunkPool
+{
+public:
+    // Size actually reserved for a request of size bytes: its chunk class, or size itself outside the pooled range
+    static size_t roundUp(size_t size)
+    {
+        int index = classOf(size);
+        return index < 0 ? size : classSize(index);
+    }
+
+    static void* allocate(size_t size);
+    static void deallocate(void* ptr, size_t size);
+
+    static size_t classSize(int index) { return static_cast<size_t>(MIN_CHUNK_SIZE) << (2 * index); }
+    // Class serving size bytes, -1 if size is not pooled
+    static int classOf(size_t size)
+    {
+        if (size <= MAX_SLOT_SIZE || size > MAX_CHUNK_SIZE)
+            return -1;
+        int index = 0;
+        while (classSize(index) < size)
+            ++index;
+        return index;
+    }
+};
+
+// std allocator drawing from ChunkPool, e.g. for the storage of network buffers
+template<typename T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept {}
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) { return static_cast<T*>(ChunkPool::allocate(n * sizeof(T))); }
+    void deallocate(T* p, size_t n) { ChunkPool::deallocate(p, n * sizeof(T)); }
+};
+
+template<typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) { return true; }
+template<typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) { return false; }
+
 class HashBucket
 {
 public:
@@ -56,8 +109,8 @@ public:
     {
         if (size <= 0)
             return nullptr;
-        if (size > MAX_SLOT_SIZE) // For memory larger than 512 bytes, use new
-            return operator new(size);
+        if (size > MAX_SLOT_SIZE) // For memory larger than 512 bytes, use the chunk pool (which uses new above 64K)
+            return ChunkPool::allocate(size);
 
         // Equivalent to size / 8 rounded up (because allocated memory can only be larger, not smaller)
         return getMemoryPool(((size + 7) / SLOT_BASE_SIZE) - 1).allocate();
@@ -69,7 +122,7 @@ public:
             return;
         if (size > MAX_SLOT_SIZE)
         {
-            operator delete(ptr);
+            ChunkPool::deallocate(ptr, size);
             return;
         }
 
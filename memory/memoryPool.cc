@@ -114,4 +114,126 @@ MemoryPool& HashBucket::getMemoryPool(int index)
     return memoryPool[index];
 }
 
+namespace
+{
+// Chunks a thread cache keeps per class before handing half of them back
+const size_t kThreadCacheBytes = 1024 * 1024;
+// Chunks kept on a shared free list per class, the rest is returned to the system
+const size_t kCentralCacheBytes = 16 * 1024 * 1024;
+
+struct ChunkList
+{
+    Slot*  head;
+    size_t count;
+};
+
+// Shared free lists, one per class
+struct CentralCache
+{
+    std::mutex mutex;
+    ChunkList  list;
+};
+
+CentralCache centralCache[CHUNK_CLASS_NUM];
+
+size_t threadCacheLimit(int index)
+{
+    return kThreadCacheBytes / ChunkPool::classSize(index);
+}
+
+void pushChunk(ChunkList& list, void* ptr)
+{
+    reinterpret_cast<Slot*>(ptr)->next = list.head;
+    list.head = reinterpret_cast<Slot*>(ptr);
+    ++list.count;
+}
+
+void* popChunk(ChunkList& list)
+{
+    Slot* chunk = list.head;
+    list.head = chunk->next;
+    --list.count;
+    return chunk;
+}
+
+// Move up to count chunks from one list to the other
+void moveChunks(ChunkList& from, ChunkList& to, size_t count)
+{
+    while (count-- > 0 && from.head)
+        pushChunk(to, popChunk(from));
+}
+
+// Free chunks of the calling thread, given back to the shared lists when the thread exits
+struct ThreadCache
+{
+    ChunkList lists[CHUNK_CLASS_NUM];
+
+    ThreadCache()
+    {
+        for (int i = 0; i < CHUNK_CLASS_NUM; i++)
+            lists[i] = ChunkList{nullptr, 0};
+    }
+
+    ~ThreadCache()
+    {
+        for (int i = 0; i < CHUNK_CLASS_NUM; i++)
+            releaseToCentral(i, lists[i].count);
+    }
+
+    // Hand count chunks to the shared list, deleting what exceeds its bound
+    void releaseToCentral(int index, size_t count)
+    {
+        ChunkList& list = lists[index];
+        {
+            CentralCache& central = centralCache[index];
+            std::lock_guard<std::mutex> lock(central.mutex);
+            size_t room = kCentralCacheBytes / ChunkPool::classSize(index) - central.list.count;
+            size_t moved = count < room ? count : room;
+            moveChunks(list, central.list, moved);
+            count -= moved;
+        }
+        while (count-- > 0 && list.head)
+            operator delete(popChunk(list));
+    }
+};
+
+thread_local ThreadCache threadCache;
+} // namespace
+
+void* ChunkPool::allocate(size_t size)
+{
+    int index = classOf(size);
+    if (index < 0)
+        return operator new(size);
+
+    ChunkList& list = threadCache.lists[index];
+    if (list.head == nullptr)
+    {
+        // Refill half of the thread cache in one go
+        CentralCache& central = centralCache[index];
+        std::lock_guard<std::mutex> lock(central.mutex);
+        moveChunks(central.list, list, threadCacheLimit(index) / 2);
+    }
+    if (list.head == nullptr)
+        return operator new(classSize(index));
+    return popChunk(list);
+}
+
+void ChunkPool::deallocate(void* ptr, size_t size)
+{
+    if (!ptr)
+        return;
+    int index = classOf(size);
+    if (index < 0)
+    {
+        operator delete(ptr);
+        return;
+    }
+
+    ChunkList& list = threadCache.lists[index];
+    pushChunk(list, ptr);
+    if (list.count > threadCacheLimit(index))
+        threadCache.releaseToCentral(index, list.count / 2);
+}
+
 } // namespace memoryPool
@@ -2,7 +2,9 @@
 #include <sys/socket.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <Acceptor.h>
+#include <EventLoop.h>
 #include <Logger.h>
 #include <InetAddress.h>
 
@@ -21,9 +23,11 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusepor
     , acceptSocket_(createNonblocking())
     , acceptChannel_(loop, acceptSocket_.fd())
     , listenning_(false)
+    , idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
+    , backingOff_(false)
 {
     acceptSocket_.setReuseAddr(true);
-    acceptSocket_.setReusePort(true);
+    acceptSocket_.setReusePort(reuseport);
     acceptSocket_.bindAddress(listenAddr);
     // TcpServer::start() => Acceptor.listen() If there is a new user connection, execute a callback (accept => connfd => package into Channel => wake up subloop)
     // baseloop detects an event => acceptChannel_(listenfd) => execute this callback function
@@ -33,8 +37,16 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusepor
 
 Acceptor::~Acceptor()
 {
+    if (backingOff_)
+    {
+        loop_->cancel(backoffTimer_); // Its callback points at this acceptor
+    }
     acceptChannel_.disableAll();    // Remove interested events from Poller
     acceptChannel_.remove();        // Call EventLoop->removeChannel => Poller->removeChannel to remove the corresponding part from Poller's ChannelMap
+    if (idleFd_ >= 0)
+    {
+        ::close(idleFd_);
+    }
 }
 
 void Acceptor::listen()
@@ -44,28 +56,78 @@ void Acceptor::listen()
     acceptChannel_.enableReading(); // Register acceptChannel_ to Poller !Important
 }
 
-// listenfd has an event, meaning there is a new user connection
+// listenfd has an event, meaning there are new user connections. Accept them until the backlog is drained (EAGAIN) or kMaxAcceptsPerRead is reached
 void Acceptor::handleRead()
 {
-    InetAddress peerAddr;
-    int connfd = acceptSocket_.accept(&peerAddr);
-    if (connfd >= 0)
+    for (int i = 0; i < kMaxAcceptsPerRead; ++i)
     {
-        if (NewConnectionCallback_)
+        InetAddress peerAddr;
+        int connfd = acceptSocket_.accept(&peerAddr);
+        if (connfd >= 0)
+        {
+            if (NewConnectionCallback_)
+            {
+                NewConnectionCallback_(connfd, peerAddr); // Poll to find subLoop, wake up and distribute the current new client's Channel
+            }
+            else
+            {
+                ::close(connfd);
+            }
+            continue;
+        }
+
+        int savedErrno = errno;
+        if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK)
+        {
+            break; // No more pending connections
+        }
+        if (savedErrno == EMFILE || savedErrno == ENFILE)
         {
-            NewConnectionCallback_(connfd, peerAddr); // Poll to find subLoop, wake up and distribute the current new client's Channel
+            LOG_ERROR<<"sockfd reached limit";
+            // The connection stays in the backlog and listenfd stays readable: drop it, otherwise the loop spins
+            if (!dropPendingConnection())
+            {
+                // No reserve fd to drop it with either: stop watching listenfd for a while instead of spinning
+                LOG_ERROR<<"Acceptor::handleRead - no spare fd, pausing accept for "<<kAcceptBackoffSeconds<<"s";
+                acceptChannel_.disableReading();
+                backingOff_ = true;
+                backoffTimer_ = loop_->runAfter(kAcceptBackoffSeconds, std::bind(&Acceptor::resumeAccept, this));
+                break;
+            }
         }
-        else
+        else if (savedErrno != ECONNABORTED && savedErrno != EINTR && savedErrno != EPROTO)
         {
-            ::close(connfd);
+            LOG_ERROR<<"accept Err "<<savedErrno;
+            break;
         }
     }
-    else
+}
+
+bool Acceptor::dropPendingConnection()
+{
+    if (idleFd_ < 0) // A previous reopen failed, try to get the reserve back first
     {
-        LOG_ERROR<<"accept Err";
-        if (errno == EMFILE)
+        idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if (idleFd_ < 0)
         {
-            LOG_ERROR<<"sockfd reached limit";
+            return false;
         }
     }
-}
\ No newline at end of file
+    ::close(idleFd_);
+    int connfd = ::accept(acceptSocket_.fd(), nullptr, nullptr);
+    if (connfd >= 0)
+    {
+        ::close(connfd); // The peer sees a clean close instead of waiting in the backlog
+    }
+    idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return true;
+}
+
+void Acceptor::resumeAccept()
+{
+    backingOff_ = false;
+    if (listenning_)
+    {
+        acceptChannel_.enableReading(); // Still out of fds: the next EMFILE pauses again
+    }
+}
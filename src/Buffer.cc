@@ -1,22 +1,77 @@
 #include <errno.h>
 #include <sys/uio.h>
 #include <unistd.h>
+#include <memory>
 
 #include <Buffer.h>
 
+namespace
+{
+/**
+ * Overflow area of Buffer::readFd, one per thread and so one per EventLoop. It is never initialized: readv only
+ * writes into it and append() copies out exactly what was read.
+ *
+ * The size follows recent reads: it doubles when a read fills it completely (the socket had more),
+ * and halves when the decaying average of the overflow stays under an eighth of it.
+ **/
+class ExtraBuffer
+{
+public:
+    static const size_t kMinSize = 16 * 1024;
+    static const size_t kMaxSize = 1024 * 1024;
+
+    ExtraBuffer()
+        : data_(new char[64 * 1024])
+        , size_(64 * 1024)
+        , average_(0)
+    {
+    }
+
+    char *data() { return data_.get(); }
+    size_t size() const { return size_; }
+
+    // used: bytes of the last read that went into the overflow area
+    void adapt(size_t used)
+    {
+        average_ = (average_ * 7 + used) / 8;
+        if (used == size_ && size_ < kMaxSize)
+        {
+            resize(size_ * 2);
+        }
+        else if (size_ > kMinSize && average_ < size_ / 8)
+        {
+            resize(size_ / 2);
+        }
+    }
+
+private:
+    void resize(size_t size)
+    {
+        data_.reset(new char[size]); // Contents are dead between reads, nothing to keep
+        size_ = size;
+    }
+
+    std::unique_ptr<char[]> data_;
+    size_t size_;
+    size_t average_; // Decaying average of the overflow per read
+};
+
+thread_local ExtraBuffer t_extraBuffer;
+}
+
 /**
  * Read data from fd, Poller works in LT mode
  * Buffer has a size limit! But when reading data from fd, we don't know the final size of the TCP data
  * 
  * @description: The method to read from socket to buffer uses readv to read into buffer_ first,
- * If buffer_ space is not enough, it will read into a 65536-byte space on the stack, then append
+ * If buffer_ space is not enough, it will read into the thread's extra buffer, then append
  * to buffer_. This approach avoids the overhead of system calls while not affecting data reception.
  **/
 ssize_t Buffer::readFd(int fd, int *saveErrno)
 {
-    // Extra stack space, used when reading from socket and buffer_ is temporarily insufficient,
+    // Extra space of this thread, used when reading from socket and buffer_ is temporarily insufficient,
     // temporarily store data until buffer_ is reallocated with enough space, then swap data to buffer_.
-    char extrabuf[65536] = {0}; // Stack memory space 65536/1024 = 64KB
+    ExtraBuffer &extra = t_extraBuffer;
 
     /*
     struct iovec {
@@ -32,15 +87,13 @@ ssize_t Buffer::readFd(int fd, int *saveErrno)
     // The first buffer, points to writable space
     vec[0].iov_base = begin() + writerIndex_;
     vec[0].iov_len = writable;
-    // The second buffer, points to stack space
-    vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof extrabuf;
+    // The second buffer, points to the extra space of this thread
+    vec[1].iov_base = extra.data();
+    vec[1].iov_len = extra.size();
 
-    // when there is enough space in this buffer, don't read into extrabuf.
-    // when extrabuf is used, we read 128k-1 bytes at most.
-    // The reason for saying at most 128k-1 bytes is: if writable is 64k-1, then two buffers are needed, the first is 64k-1, the second is 64k, so at most 128k-1
-    // If the first buffer >= 64k, then only one buffer is used and the stack space extrabuf[65536] is not used
-    const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
+    // when there is enough space in this buffer, don't read into the extra space.
+    // The first buffer alone is used once it is at least as large as the extra space
+    const int iovcnt = (writable < extra.size()) ? 2 : 1;
     const ssize_t n = ::readv(fd, vec, iovcnt);
 
     if (n < 0)
@@ -50,12 +103,18 @@ ssize_t Buffer::readFd(int fd, int *saveErrno)
     else if (n <= writable) // Buffer is enough
     {
         writerIndex_ += n;
+        if (iovcnt == 2)
+        {
+            extra.adapt(0);
+        }
     }
-    else // extrabuf is also written
+    else // the extra space is also written
     {
         writerIndex_ = buffer_.size();
-        append(extrabuf, n - writable); // writerIndex_ begins to write from buffer_.size()
+        append(extra.data(), n - writable); // writerIndex_ begins to write from buffer_.size()
+        extra.adapt(n - writable);
     }
+    notePeak();
     return n;
 }
 
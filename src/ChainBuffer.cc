@@ -0,0 +1,270 @@
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <algorithm>
+
+#include <ChainBuffer.h>
+#include <memoryPool.h>
+
+const size_t ChainBuffer::kBlockSize;
+const size_t ChainBuffer::kReadSize;
+
+ChainBuffer::ChainBuffer()
+    : spare_(0)
+    , readable_(0)
+{
+}
+
+ChainBuffer::~ChainBuffer()
+{
+    for (const Block &block : blocks_)
+    {
+        memoryPool::ChunkPool::deallocate(block.data, kBlockSize);
+    }
+}
+
+void ChainBuffer::swap(ChainBuffer &rhs)
+{
+    blocks_.swap(rhs.blocks_);
+    std::swap(spare_, rhs.spare_);
+    std::swap(readable_, rhs.readable_);
+}
+
+const char *ChainBuffer::peek() const
+{
+    if (readable_ == 0)
+    {
+        return nullptr;
+    }
+    const Block &head = blocks_.front();
+    return head.data + head.readIndex;
+}
+
+size_t ChainBuffer::contiguousBytes() const
+{
+    if (readable_ == 0)
+    {
+        return 0;
+    }
+    const Block &head = blocks_.front();
+    return head.writeIndex - head.readIndex;
+}
+
+size_t ChainBuffer::copyOut(char *dst, size_t len, size_t offset) const
+{
+    size_t copied = 0;
+    for (size_t i = 0; i < blocks_.size() - spare_ && copied < len; ++i)
+    {
+        const Block &block = blocks_[i];
+        size_t size = block.writeIndex - block.readIndex;
+        if (offset >= size)
+        {
+            offset -= size;
+            continue;
+        }
+        size_t n = std::min(size - offset, len - copied);
+        ::memcpy(dst + copied, block.data + block.readIndex + offset, n);
+        copied += n;
+        offset = 0;
+    }
+    return copied;
+}
+
+void ChainBuffer::retrieve(size_t len)
+{
+    if (len >= readable_)
+    {
+        retrieveAll();
+        return;
+    }
+    readable_ -= len;
+    while (len > 0)
+    {
+        Block &head = blocks_.front();
+        size_t size = head.writeIndex - head.readIndex;
+        if (len < size)
+        {
+            head.readIndex += len;
+            return;
+        }
+        // Only whole blocks are freed, so the tail block with data is never reached here: readable_ would be 0
+        len -= size;
+        memoryPool::ChunkPool::deallocate(head.data, kBlockSize);
+        blocks_.pop_front();
+    }
+}
+
+void ChainBuffer::retrieveAll()
+{
+    // Keep the blocks as spares, up to the size of a read
+    size_t keep = kReadSize / kBlockSize;
+    while (blocks_.size() > keep)
+    {
+        memoryPool::ChunkPool::deallocate(blocks_.back().data, kBlockSize);
+        blocks_.pop_back();
+    }
+    for (Block &block : blocks_)
+    {
+        block.readIndex = 0;
+        block.writeIndex = 0;
+    }
+    spare_ = blocks_.size();
+    readable_ = 0;
+}
+
+std::string ChainBuffer::retrieveAsString(size_t len)
+{
+    std::string result(std::min(len, readable_), '\0');
+    copyOut(&*result.begin(), result.size());
+    retrieve(result.size());
+    return result;
+}
+
+size_t ChainBuffer::writableBytes() const
+{
+    size_t writable = spare_ * kBlockSize;
+    if (blocks_.size() > spare_)
+    {
+        writable += kBlockSize - blocks_[blocks_.size() - spare_ - 1].writeIndex;
+    }
+    return writable;
+}
+
+void ChainBuffer::ensureWritableBytes(size_t len)
+{
+    for (size_t writable = writableBytes(); writable < len; writable += kBlockSize)
+    {
+        Block block;
+        block.data = static_cast<char *>(memoryPool::ChunkPool::allocate(kBlockSize));
+        block.readIndex = 0;
+        block.writeIndex = 0;
+        blocks_.push_back(block);
+        ++spare_;
+    }
+}
+
+void ChainBuffer::append(const char *data, size_t len)
+{
+    struct iovec vec[kMaxIovecs];
+    while (len > 0)
+    {
+        int iovcnt = writableIovecs(vec, kMaxIovecs, len);
+        size_t copied = 0;
+        for (int i = 0; i < iovcnt && copied < len; ++i)
+        {
+            size_t n = std::min(vec[i].iov_len, len - copied);
+            ::memcpy(vec[i].iov_base, data + copied, n);
+            copied += n;
+        }
+        hasWritten(copied);
+        data += copied;
+        len -= copied;
+    }
+}
+
+int ChainBuffer::readableIovecs(struct iovec *vec, int maxIovecs) const
+{
+    int iovcnt = 0;
+    for (size_t i = 0; i < blocks_.size() - spare_ && iovcnt < maxIovecs; ++i)
+    {
+        const Block &block = blocks_[i];
+        if (block.writeIndex > block.readIndex)
+        {
+            vec[iovcnt].iov_base = block.data + block.readIndex;
+            vec[iovcnt].iov_len = block.writeIndex - block.readIndex;
+            ++iovcnt;
+        }
+    }
+    return iovcnt;
+}
+
+int ChainBuffer::writableIovecs(struct iovec *vec, int maxIovecs, size_t len)
+{
+    ensureWritableBytes(len);
+    int iovcnt = 0;
+    size_t i = blocks_.size() - spare_;
+    if (i > 0 && blocks_[i - 1].writeIndex < kBlockSize && iovcnt < maxIovecs)
+    {
+        Block &tail = blocks_[i - 1];
+        vec[iovcnt].iov_base = tail.data + tail.writeIndex;
+        vec[iovcnt].iov_len = kBlockSize - tail.writeIndex;
+        ++iovcnt;
+    }
+    for (; i < blocks_.size() && iovcnt < maxIovecs; ++i)
+    {
+        vec[iovcnt].iov_base = blocks_[i].data;
+        vec[iovcnt].iov_len = kBlockSize;
+        ++iovcnt;
+    }
+    return iovcnt;
+}
+
+void ChainBuffer::hasWritten(size_t len)
+{
+    readable_ += len;
+    size_t i = blocks_.size() - spare_;
+    if (i > 0)
+    {
+        Block &tail = blocks_[i - 1];
+        size_t n = std::min(kBlockSize - tail.writeIndex, len);
+        tail.writeIndex += n;
+        len -= n;
+    }
+    // The rest fills spare blocks, which become data blocks
+    for (; len > 0; ++i)
+    {
+        size_t n = std::min(kBlockSize, len);
+        blocks_[i].writeIndex = n;
+        --spare_;
+        len -= n;
+    }
+}
+
+void ChainBuffer::shrink()
+{
+    for (; spare_ > 0; --spare_)
+    {
+        memoryPool::ChunkPool::deallocate(blocks_.back().data, kBlockSize);
+        blocks_.pop_back();
+    }
+}
+
+/**
+ * Unlike Buffer::readFd there is no overflow area: the blocks are topped up to kReadSize writable bytes first,
+ * readv fills them in place, and unused blocks stay as spares for the next read.
+ **/
+ssize_t ChainBuffer::readFd(int fd, int *saveErrno)
+{
+    struct iovec vec[kMaxIovecs];
+    int iovcnt = writableIovecs(vec, kMaxIovecs, kReadSize);
+    const ssize_t n = ::readv(fd, vec, iovcnt);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    else
+    {
+        hasWritten(n);
+    }
+    return n;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int *saveErrno)
+{
+    struct iovec vec[kMaxIovecs];
+    int iovcnt = readableIovecs(vec, kMaxIovecs);
+    if (iovcnt == 0)
+    {
+        return 0;
+    }
+    const ssize_t n = ::writev(fd, vec, iovcnt);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    else
+    {
+        retrieve(n);
+    }
+    return n;
+}
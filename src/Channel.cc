@@ -15,6 +15,7 @@ Channel::Channel(EventLoop *loop, int fd)
     , events_(0)
     , revents_(0)
     , index_(-1)
+    , edgeTriggered_(false)
     , tied_(false)
 {
 }
@@ -86,8 +87,8 @@ void Channel::handleEventWithGuard(Timestamp receiveTime)
             errorCallback_();
         }
     }
-    // Read
-    if (revents_ & (EPOLLIN | EPOLLPRI))
+    // Read (an edge-triggered fd is always armed for both directions, so filter by the events of interest)
+    if ((revents_ & (EPOLLIN | EPOLLPRI)) && (!edgeTriggered_ || isReading()))
     {
         if (readCallback_)
         {
@@ -95,7 +96,7 @@ void Channel::handleEventWithGuard(Timestamp receiveTime)
         }
     }
     // Write
-    if (revents_ & EPOLLOUT)
+    if ((revents_ & EPOLLOUT) && (!edgeTriggered_ || isWriting()))
     {
         if (writeCallback_)
         {
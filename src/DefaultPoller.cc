@@ -2,6 +2,8 @@
 
 #include <Poller.h>
 #include <EPollPoller.h>
+#include <IoUringPoller.h>
+#include <Logger.h>
 
 Poller *Poller::newDefaultPoller(EventLoop *loop)
 {
@@ -9,8 +11,30 @@ Poller *Poller::newDefaultPoller(EventLoop *loop)
     {
         return nullptr; // Generate an instance of poll
     }
+    else if (::getenv("MUDUO_USE_URING"))
+    {
+        return newPoller(loop, kIoUringBackend); // Generate an instance of io_uring
+    }
     else
     {
         return new EPollPoller(loop); // Generate an instance of epoll
     }
-}
\ No newline at end of file
+}
+
+Poller *Poller::newPoller(EventLoop *loop, Backend backend)
+{
+    switch (backend)
+    {
+    case kEPollBackend:
+        return new EPollPoller(loop);
+    case kIoUringBackend:
+        if (IoUringPoller::isSupported())
+        {
+            return new IoUringPoller(loop);
+        }
+        LOG_WARN << "io_uring is not supported by this kernel, falling back to epoll";
+        return new EPollPoller(loop);
+    default:
+        return newDefaultPoller(loop);
+    }
+}
@@ -80,13 +80,12 @@ void EPollPoller::updateChannel(Channel *channel)
     }
     else // The channel has already been registered in Poller
     {
-        int fd = channel->fd();
         if (channel->isNoneEvent())
         {
             update(EPOLL_CTL_DEL, channel);
             channel->set_index(kDeleted);
         }
-        else
+        else if (!channel->isEdgeTriggered()) // An edge-triggered channel is already armed for every event
         {
             update(EPOLL_CTL_MOD, channel);
         }
@@ -128,7 +127,8 @@ void EPollPoller::update(int operation, Channel *channel)
 
     int fd = channel->fd();
 
-    event.events = channel->events();
+    // Edge-triggered channels listen for both directions once instead of being modified on every enable/disable
+    event.events = channel->isEdgeTriggered() ? (EPOLLIN | EPOLLPRI | EPOLLOUT | EPOLLET) : channel->events();
     event.data.fd = fd;
     event.data.ptr = channel;
 
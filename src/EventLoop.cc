@@ -40,14 +40,16 @@ int createEventfd()
     return evtfd;
 }
 
-EventLoop::EventLoop()
+EventLoop::EventLoop(Poller::Backend backend)
     : looping_(false)
     , quit_(false)
-    , callingPendingFunctors_(false)
     , threadId_(CurrentThread::tid())
-    , poller_(Poller::newDefaultPoller(this))
+    , poller_(Poller::newPoller(this, backend))
+    , timerQueue_(new TimerQueue(this))
     , wakeupFd_(createEventfd())
     , wakeupChannel_(new Channel(this, wakeupFd_))
+    , callingPendingFunctors_(false)
+    , wakeupPending_(false)
 {
     LOG_DEBUG<<"EventLoop created"<<this<<"in thread"<<threadId_;
     if (t_loopInThisThread)
@@ -130,23 +132,22 @@ void EventLoop::runInLoop(Functor cb)
     }
     else // If cb is executed in a non-current EventLoop thread, it is necessary to wake up the thread where the EventLoop is located to execute cb
     {
-        queueInLoop(cb);
+        queueInLoop(std::move(cb));
     }
 }
 
 // Put cb into the queue and wake up the thread where the loop is located to execute cb
 void EventLoop::queueInLoop(Functor cb)
 {
-    {
-        std::unique_lock<std::mutex> lock(mutex_);
-        pendingFunctors_.emplace_back(cb);
-    }
+    pendingFunctors_.push(std::move(cb)); // No lock: an atomic exchange on the queue head
 
     /**
      * || callingPendingFunctors means that the current loop is executing callbacks, but new callbacks are added to the loop's pendingFunctors_. It is necessary to wake up the corresponding loop thread that needs to execute the above callback operation through a wakeup write event.
      * This ensures that the next poller_->poll() in loop() will not block (blocking would delay the execution of the newly added callback), and then continue to execute the callbacks in pendingFunctors_.
+     *
+     * Only the first enqueuer after a drain writes the eventfd, the others see wakeupPending_ already set and skip the syscall.
      **/
-    if (!isInLoopThread() || callingPendingFunctors_)
+    if ((!isInLoopThread() || callingPendingFunctors_) && !wakeupPending_.exchange(true))
     {
         wakeup(); // Wake up the thread where the loop is located
     }
@@ -191,18 +192,14 @@ bool EventLoop::hasChannel(Channel *channel)
 
 void EventLoop::doPendingFunctors()
 {
-    std::vector<Functor> functors;
     callingPendingFunctors_ = true;
+    // Cleared before draining: a functor queued after this point either is drained below or wakes the loop again
+    wakeupPending_ = false;
 
-    {
-        std::unique_lock<std::mutex> lock(mutex_);
-        functors.swap(pendingFunctors_); // Swapping reduces the scope of the lock's critical section, improves efficiency, and avoids deadlock. If functor() is executed in the critical section and functor() calls queueInLoop(), it will cause a deadlock
-    }
-
-    for (const Functor &functor : functors)
-    {
+    // Only the functors queued before the drain starts are run, ones queued by the callbacks wait for the next iteration
+    pendingFunctors_.consumeAll([](Functor &functor) {
         functor(); // Execute the callback operation that the current loop needs to execute
-    }
+    });
 
     callingPendingFunctors_ = false;
 }
@@ -2,13 +2,15 @@
 #include <EventLoop.h>
 
 EventLoopThread::EventLoopThread(const ThreadInitCallback &cb,
-                                 const std::string &name)
+                                 const std::string &name,
+                                 Poller::Backend backend)
     : loop_(nullptr)
     , exiting_(false)
     , thread_(std::bind(&EventLoopThread::threadFunc, this), name)
     , mutex_()
     , cond_()
     , callback_(cb)
+    , backend_(backend)
 {
 }
 
@@ -38,7 +40,7 @@ EventLoop *EventLoopThread::startLoop()
 // The following method runs in a separate new thread
 void EventLoopThread::threadFunc()
 {
-    EventLoop loop; // Create an independent EventLoop object, which corresponds one-to-one with the above thread (one loop per thread)
+    EventLoop loop(backend_); // Create an independent EventLoop object, which corresponds one-to-one with the above thread (one loop per thread)
 
     if (callback_)
     {
@@ -4,7 +4,7 @@
 #include <EventLoopThread.h>
 #include <Logger.h>
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg)
-    : baseLoop_(baseLoop), name_(nameArg), started_(false), numThreads_(0), next_(0), hash_(3)
+    : baseLoop_(baseLoop), name_(nameArg), started_(false), numThreads_(0), next_(0), hash_(3), backend_(Poller::kDefaultBackend)
 {
 }
 
@@ -21,10 +21,11 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
     {
         char buf[name_.size() + 32];
         snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
-        EventLoopThread *t = new EventLoopThread(cb, buf);
+        EventLoopThread *t = new EventLoopThread(cb, buf, backend_);
         threads_.push_back(std::unique_ptr<EventLoopThread>(t));
         loops_.push_back(t->startLoop()); // Create thread at the bottom, bind a new EventLoop, and return the address of the loop
         hash_.addNode(buf);               // Add the thread to the consistent hash.
+        nodeLoops_[buf] = loops_.back();
     }
 
     if (numThreads_ == 0 && cb) // Only one thread (baseLoop) runs for the entire server
@@ -36,14 +37,18 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
 // If working in multithreading, baseLoop_(mainLoop) will assign Channels to subLoops in a polling manner by default
 EventLoop *EventLoopThreadPool::getNextLoop(const std::string &key)
 {
-    size_t index = hash_.getNode(key); // Get index
-    if (index >= loops_.size())
+    if (loops_.empty()) // Single reactor: the baseLoop handles every connection
+    {
+        return baseLoop_;
+    }
+    auto it = nodeLoops_.find(hash_.getNode(key)); // Get the node name
+    if (it == nodeLoops_.end())
     {
         // Handle errors, such as returning baseLoop or throwing an exception
         LOG_ERROR<<"EventLoopThreadPool::getNextLoop ERROR";
         return baseLoop_; // Or return nullptr
     }
-    return loops_[index]; // Access loops_ using the index
+    return it->second;
 }
 
 
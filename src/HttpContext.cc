@@ -0,0 +1,141 @@
+#include <strings.h>
+
+#include <HttpContext.h>
+#include <HttpParser.h>
+#include <Buffer.h>
+
+namespace
+{
+bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size() && ::strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+HttpRequest::Span spanOf(const char *base, const char *begin, const char *end)
+{
+    return HttpRequest::Span{static_cast<uint32_t>(begin - base), static_cast<uint32_t>(end - begin)};
+}
+} // namespace
+
+HttpContext::HttpContext()
+    : state_(kExpectHead)
+    , scanned_(0)
+    , bodyLength_(0)
+    , maxHeaderBytes_(kDefaultMaxHeaderBytes)
+    , maxBodyBytes_(kDefaultMaxBodyBytes)
+    , errorStatus_(HttpResponse::kUnknown)
+{
+}
+
+HttpContext::ParseResult HttpContext::parseRequest(Buffer *buf, Timestamp receiveTime)
+{
+    if (state_ == kExpectHead)
+    {
+        // Empty lines in front of a request are ignored (RFC 9112 2.2)
+        while (scanned_ == 0 && buf->readableBytes() >= 2 && buf->peek()[0] == '\r' && buf->peek()[1] == '\n')
+        {
+            buf->retrieve(2);
+        }
+        const char *base = buf->peek();
+        const char *headEnd = httpparser::findHeadEnd(base, buf->beginWrite(), base + scanned_);
+        if (headEnd == nullptr)
+        {
+            if (buf->readableBytes() > maxHeaderBytes_)
+            {
+                return fail(HttpResponse::k431RequestHeaderFieldsTooLarge);
+            }
+            // The blank line may straddle the end of what has arrived
+            scanned_ = buf->readableBytes() > 3 ? buf->readableBytes() - 3 : 0;
+            return kNeedMore;
+        }
+        scanned_ = headEnd - base;
+        if (scanned_ > maxHeaderBytes_)
+        {
+            return fail(HttpResponse::k431RequestHeaderFieldsTooLarge);
+        }
+        if (!httpparser::parseRequestHead(base, headEnd, &request_, &errorStatus_))
+        {
+            return kError;
+        }
+        request_.setReceiveTime(receiveTime);
+        if (!finishHeaders(base))
+        {
+            return kError;
+        }
+    }
+
+    const char *base = buf->peek();
+    if (state_ == kExpectBody)
+    {
+        if (buf->readableBytes() - scanned_ < bodyLength_)
+        {
+            return kNeedMore;
+        }
+        request_.setBody(spanOf(base, base + scanned_, base + scanned_ + bodyLength_));
+        scanned_ += bodyLength_;
+        state_ = kGotAll;
+    }
+    request_.setBase(base);
+    return kComplete;
+}
+
+bool HttpContext::finishHeaders(const char *base)
+{
+    request_.setBase(base);
+    if (!request_.getHeader("Transfer-Encoding").empty())
+    {
+        fail(HttpResponse::k501NotImplemented); // Chunked request bodies are not supported
+        return false;
+    }
+    // Every Content-Length must carry the same non-empty value (RFC 9112 6.3): a proxy in front that picked
+    // another one, or read a blank one differently, would disagree on where this request ends
+    std::string_view length;
+    bool hasLength = false;
+    for (size_t i = 0; i < request_.headerCount(); ++i)
+    {
+        if (!equalsIgnoreCase(request_.headerName(i), "Content-Length"))
+        {
+            continue;
+        }
+        std::string_view value = request_.headerValue(i);
+        if (value.empty() || (hasLength && value != length))
+        {
+            fail(HttpResponse::k400BadRequest);
+            return false;
+        }
+        length = value;
+        hasLength = true;
+    }
+    bodyLength_ = 0;
+    for (char c : length)
+    {
+        if (c < '0' || c > '9' || bodyLength_ > maxBodyBytes_)
+        {
+            fail(c < '0' || c > '9' ? HttpResponse::k400BadRequest : HttpResponse::k413PayloadTooLarge);
+            return false;
+        }
+        bodyLength_ = bodyLength_ * 10 + (c - '0');
+    }
+    if (bodyLength_ > maxBodyBytes_)
+    {
+        fail(HttpResponse::k413PayloadTooLarge);
+        return false;
+    }
+    state_ = bodyLength_ > 0 ? kExpectBody : kGotAll;
+    return true;
+}
+
+HttpContext::ParseResult HttpContext::fail(HttpResponse::StatusCode status)
+{
+    errorStatus_ = status;
+    return kError;
+}
+
+void HttpContext::reset()
+{
+    state_ = kExpectHead;
+    request_.reset();
+    scanned_ = 0;
+    bodyLength_ = 0;
+    errorStatus_ = HttpResponse::kUnknown;
+}
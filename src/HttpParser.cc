@@ -0,0 +1,331 @@
+#include <string.h>
+
+#include <HttpParser.h>
+#include <StringSearch.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define HTTPPARSER_HAVE_X86 1 // SSE4.2 and AVX2 are checked at runtime
+#endif
+
+namespace httpparser
+{
+namespace
+{
+// What a span may contain, the first byte outside of it ends the span
+enum CharClass
+{
+    kTarget, // Visible ASCII and obs-text: stops at SP and controls
+    kName,   // Visible ASCII but ':': stops at ':', SP, controls and obs-text
+    kValue   // Anything but controls, HTAB excepted
+};
+
+constexpr bool isStop(CharClass cls, unsigned c)
+{
+    switch (cls)
+    {
+    case kTarget:
+        return c <= 0x20 || c == 0x7f;
+    case kName:
+        return c <= 0x20 || c == ':' || c >= 0x7f;
+    default:
+        return (c < 0x20 && c != '\t') || c == 0x7f;
+    }
+}
+
+struct StopTable
+{
+    bool stop[256];
+};
+
+constexpr StopTable makeTable(CharClass cls)
+{
+    StopTable table{};
+    for (unsigned c = 0; c < 256; ++c)
+    {
+        table.stop[c] = isStop(cls, c);
+    }
+    return table;
+}
+
+constexpr StopTable kStopTables[3] = {makeTable(kTarget), makeTable(kName), makeTable(kValue)};
+
+template <CharClass Class>
+const char *findStopScalar(const char *p, const char *end)
+{
+    const bool *stop = kStopTables[Class].stop;
+    while (p < end && !stop[static_cast<unsigned char>(*p)])
+    {
+        ++p;
+    }
+    return p;
+}
+
+#ifdef HTTPPARSER_HAVE_X86
+// PCMPESTRI in range mode: the index of the first byte falling in one of the [lo, hi] pairs, 16 if none
+template <CharClass Class>
+__attribute__((target("sse4.2")))
+const char *findStopSse42(const char *p, const char *end)
+{
+    alignas(16) static const char kRanges[3][16] = {
+        "\x00\x20\x7f\x7f",
+        "\x00\x20\x3a\x3a\x7f\xff",
+        "\x00\x08\x0a\x1f\x7f\x7f",
+    };
+    static const int kRangeLengths[3] = {4, 6, 6};
+
+    const __m128i ranges = _mm_load_si128(reinterpret_cast<const __m128i *>(kRanges[Class]));
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        int index = _mm_cmpestri(ranges, kRangeLengths[Class], block, 16,
+                                 _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+        if (index != 16)
+        {
+            return p + index;
+        }
+    }
+    return findStopScalar<Class>(p, end);
+}
+
+// AVX2 has only signed byte compares: bytes >= 0x80 are negative and masked out where they are allowed
+template <CharClass Class>
+__attribute__((target("avx2")))
+const char *findStopAvx2(const char *p, const char *end)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    for (; end - p >= 32; p += 32)
+    {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i high = _mm256_cmpgt_epi8(zero, block);
+        __m256i stop = _mm256_cmpeq_epi8(block, del);
+        if (Class == kTarget)
+        {
+            __m256i low = _mm256_andnot_si256(high, _mm256_cmpgt_epi8(_mm256_set1_epi8(0x21), block));
+            stop = _mm256_or_si256(stop, low);
+        }
+        else if (Class == kName)
+        {
+            __m256i low = _mm256_cmpgt_epi8(_mm256_set1_epi8(0x21), block); // obs-text included
+            stop = _mm256_or_si256(stop, _mm256_or_si256(low, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(':'))));
+        }
+        else
+        {
+            __m256i control = _mm256_andnot_si256(high, _mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), block));
+            control = _mm256_andnot_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t')), control);
+            stop = _mm256_or_si256(stop, control);
+        }
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(stop));
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findStopScalar<Class>(p, end);
+}
+#endif
+
+template <Impl I, CharClass Class>
+const char *findStop(const char *p, const char *end)
+{
+#ifdef HTTPPARSER_HAVE_X86
+    if (I == kAvx2)
+    {
+        return findStopAvx2<Class>(p, end);
+    }
+    if (I == kSse42)
+    {
+        return findStopSse42<Class>(p, end);
+    }
+#endif
+    return findStopScalar<Class>(p, end);
+}
+
+struct MethodName
+{
+    const char *name;
+    size_t length;
+    HttpRequest::Method method;
+};
+
+const MethodName kMethods[] = {
+    {"GET", 3, HttpRequest::kGet},
+    {"POST", 4, HttpRequest::kPost},
+    {"HEAD", 4, HttpRequest::kHead},
+    {"PUT", 3, HttpRequest::kPut},
+    {"DELETE", 6, HttpRequest::kDelete},
+    {"OPTIONS", 7, HttpRequest::kOptions},
+};
+const size_t kMaxMethodLength = 7;
+
+HttpRequest::Span spanOf(const char *base, const char *begin, const char *end)
+{
+    return HttpRequest::Span{static_cast<uint32_t>(begin - base), static_cast<uint32_t>(end - begin)};
+}
+
+bool fail(HttpResponse::StatusCode status, HttpResponse::StatusCode *error)
+{
+    *error = status;
+    return false;
+}
+
+template <Impl I>
+bool parseHead(const char *begin, const char *end, HttpRequest *req, HttpResponse::StatusCode *error)
+{
+    // Method: a few bytes, matched against the known names
+    const size_t searchLength = static_cast<size_t>(end - begin) < kMaxMethodLength + 1 ? end - begin : kMaxMethodLength + 1;
+    const char *space = static_cast<const char *>(::memchr(begin, ' ', searchLength));
+    if (space == nullptr)
+    {
+        return fail(HttpResponse::k400BadRequest, error);
+    }
+    HttpRequest::Method method = HttpRequest::kInvalid;
+    for (const MethodName &m : kMethods)
+    {
+        if (static_cast<size_t>(space - begin) == m.length && ::memcmp(begin, m.name, m.length) == 0)
+        {
+            method = m.method;
+            break;
+        }
+    }
+    if (method == HttpRequest::kInvalid)
+    {
+        return fail(HttpResponse::k501NotImplemented, error);
+    }
+    req->setMethod(method);
+
+    // Request target, split at the first '?'
+    const char *target = space + 1;
+    const char *p = findStop<I, kTarget>(target, end);
+    if (p == target || p == end || *p != ' ')
+    {
+        return fail(HttpResponse::k400BadRequest, error);
+    }
+    const char *question = static_cast<const char *>(::memchr(target, '?', p - target));
+    if (question != nullptr)
+    {
+        req->setPath(spanOf(begin, target, question));
+        req->setQuery(spanOf(begin, question + 1, p));
+    }
+    else
+    {
+        req->setPath(spanOf(begin, target, p));
+    }
+
+    // "HTTP/1.x" CRLF
+    ++p;
+    if (end - p < 10 || ::memcmp(p, "HTTP/1.", 7) != 0 || p[8] != '\r' || p[9] != '\n')
+    {
+        return fail(HttpResponse::k400BadRequest, error);
+    }
+    if (p[7] == '1')
+    {
+        req->setVersion(HttpRequest::kHttp11);
+    }
+    else if (p[7] == '0')
+    {
+        req->setVersion(HttpRequest::kHttp10);
+    }
+    else
+    {
+        return fail(HttpResponse::k505HttpVersionNotSupported, error);
+    }
+    p += 10;
+
+    // Header fields up to the blank line. The head ends with CRLF CRLF, so every scan stops before end
+    while (end - p >= 2 && !(p[0] == '\r' && p[1] == '\n'))
+    {
+        const char *name = p;
+        const char *colon = findStop<I, kName>(name, end);
+        // No whitespace is allowed between the field name and the colon (RFC 9112 5.1)
+        if (colon == name || colon == end || *colon != ':')
+        {
+            return fail(HttpResponse::k400BadRequest, error);
+        }
+        const char *value = colon + 1;
+        while (value < end && (*value == ' ' || *value == '\t'))
+        {
+            ++value;
+        }
+        p = findStop<I, kValue>(value, end);
+        if (end - p < 2 || p[0] != '\r' || p[1] != '\n')
+        {
+            return fail(HttpResponse::k400BadRequest, error); // Bare CR/LF, other controls or obs-fold
+        }
+        const char *valueEnd = p;
+        while (valueEnd > value && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t'))
+        {
+            --valueEnd;
+        }
+        req->addHeader(spanOf(begin, name, colon), spanOf(begin, value, valueEnd));
+        p += 2;
+    }
+    if (end - p != 2)
+    {
+        return fail(HttpResponse::k400BadRequest, error);
+    }
+    return true;
+}
+
+Impl detectImpl()
+{
+#ifdef HTTPPARSER_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return kAvx2;
+    }
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        return kSse42;
+    }
+#endif
+    return kScalar;
+}
+
+// Zero-initialized to kScalar before dynamic initialization, so calls from other static initializers are still safe
+const Impl gBestImpl = detectImpl();
+} // namespace
+
+Impl bestImpl()
+{
+    return gBestImpl;
+}
+
+const char *findHeadEnd(const char *begin, const char *end, const char *from)
+{
+    const char *p = from > begin ? from : begin;
+    for (;;)
+    {
+        const char *crlf = search::findCRLF(p, end);
+        if (crlf == nullptr || end - crlf < 4)
+        {
+            return nullptr;
+        }
+        if (crlf[2] == '\r' && crlf[3] == '\n')
+        {
+            return crlf + 4;
+        }
+        p = crlf + 2;
+    }
+}
+
+bool parseRequestHead(Impl impl, const char *begin, const char *end, HttpRequest *req, HttpResponse::StatusCode *error)
+{
+    switch (impl)
+    {
+    case kAvx2:
+        return parseHead<kAvx2>(begin, end, req, error);
+    case kSse42:
+        return parseHead<kSse42>(begin, end, req, error);
+    default:
+        return parseHead<kScalar>(begin, end, req, error);
+    }
+}
+
+bool parseRequestHead(const char *begin, const char *end, HttpRequest *req, HttpResponse::StatusCode *error)
+{
+    return parseRequestHead(gBestImpl, begin, end, req, error);
+}
+} // namespace httpparser
@@ -0,0 +1,94 @@
+#include <strings.h>
+
+#include <HttpRequest.h>
+
+namespace
+{
+bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size() && ::strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
+
+// Whether the comma-separated list contains token (case-insensitive), as in "Connection: keep-alive, Upgrade"
+bool hasToken(std::string_view list, std::string_view token)
+{
+    while (!list.empty())
+    {
+        size_t comma = list.find(',');
+        std::string_view item = list.substr(0, comma);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+        {
+            item.remove_prefix(1);
+        }
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+        {
+            item.remove_suffix(1);
+        }
+        if (equalsIgnoreCase(item, token))
+        {
+            return true;
+        }
+        if (comma == std::string_view::npos)
+        {
+            break;
+        }
+        list.remove_prefix(comma + 1);
+    }
+    return false;
+}
+} // namespace
+
+std::string_view HttpRequest::methodString() const
+{
+    switch (method_)
+    {
+    case kGet:
+        return "GET";
+    case kPost:
+        return "POST";
+    case kHead:
+        return "HEAD";
+    case kPut:
+        return "PUT";
+    case kDelete:
+        return "DELETE";
+    case kOptions:
+        return "OPTIONS";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+std::string_view HttpRequest::getHeader(std::string_view field) const
+{
+    for (const Header &header : headers_)
+    {
+        if (equalsIgnoreCase(view(header.name), field))
+        {
+            return view(header.value);
+        }
+    }
+    return std::string_view();
+}
+
+bool HttpRequest::keepAlive() const
+{
+    std::string_view connection = getHeader("Connection");
+    if (version_ == kHttp11)
+    {
+        return !hasToken(connection, "close");
+    }
+    return version_ == kHttp10 && hasToken(connection, "keep-alive");
+}
+
+void HttpRequest::reset()
+{
+    base_ = nullptr;
+    method_ = kInvalid;
+    version_ = kUnknown;
+    path_ = Span{0, 0};
+    query_ = Span{0, 0};
+    body_ = Span{0, 0};
+    headers_.clear();
+    receiveTime_ = Timestamp();
+}
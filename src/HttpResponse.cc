@@ -0,0 +1,92 @@
+#include <charconv>
+
+#include <HttpResponse.h>
+
+std::string_view HttpResponse::statusMessage(StatusCode code)
+{
+    switch (code)
+    {
+    case k200Ok:
+        return "OK";
+    case k204NoContent:
+        return "No Content";
+    case k206PartialContent:
+        return "Partial Content";
+    case k301MovedPermanently:
+        return "Moved Permanently";
+    case k304NotModified:
+        return "Not Modified";
+    case k400BadRequest:
+        return "Bad Request";
+    case k403Forbidden:
+        return "Forbidden";
+    case k404NotFound:
+        return "Not Found";
+    case k405MethodNotAllowed:
+        return "Method Not Allowed";
+    case k413PayloadTooLarge:
+        return "Payload Too Large";
+    case k416RangeNotSatisfiable:
+        return "Range Not Satisfiable";
+    case k431RequestHeaderFieldsTooLarge:
+        return "Request Header Fields Too Large";
+    case k500InternalServerError:
+        return "Internal Server Error";
+    case k501NotImplemented:
+        return "Not Implemented";
+    case k505HttpVersionNotSupported:
+        return "HTTP Version Not Supported";
+    default:
+        return "Unknown";
+    }
+}
+
+void HttpResponse::addHeader(std::string_view name, std::string_view value)
+{
+    headers_.append(name.data(), name.size());
+    headers_.append(": ", 2);
+    headers_.append(value.data(), value.size());
+    headers_.append("\r\n", 2);
+}
+
+void HttpResponse::appendHeadersToBuffer(Buffer *output, bool keepAliveHeader) const
+{
+    const StatusCode code = statusCode_ == kUnknown ? k200Ok : statusCode_;
+    char number[24];
+
+    output->append("HTTP/1.1 ", 9);
+    char *end = std::to_chars(number, number + sizeof number, static_cast<int>(code)).ptr;
+    output->append(number, end - number);
+    output->append(" ", 1);
+    std::string_view message = statusMessage(code);
+    output->append(message.data(), message.size());
+    output->append("\r\n", 2);
+
+    output->append(headers_.peek(), headers_.readableBytes());
+
+    // 1xx, 204 and 304 responses carry no body and no length. A stream is delimited by its chunks, or by the
+    // end of the connection when it is closed afterwards
+    if (streamProducer_)
+    {
+        if (!closeConnection_)
+        {
+            output->append("Transfer-Encoding: chunked\r\n", 28);
+        }
+    }
+    else if (code != k204NoContent && code != k304NotModified)
+    {
+        output->append("Content-Length: ", 16);
+        end = std::to_chars(number, number + sizeof number, bodyLength()).ptr;
+        output->append(number, end - number);
+        output->append("\r\n", 2);
+    }
+    if (closeConnection_)
+    {
+        output->append("Connection: close\r\n", 19);
+    }
+    else if (keepAliveHeader)
+    {
+        output->append("Connection: Keep-Alive\r\n", 24);
+    }
+    output->append("\r\n", 2);
+}
@@ -0,0 +1,212 @@
+#include <HttpServer.h>
+#include <HttpContext.h>
+#include <HttpStreamWriter.h>
+#include <Logger.h>
+
+namespace
+{
+// Responses of one read are gathered here before being sent, one buffer per io loop
+thread_local Buffer t_output;
+
+void defaultHttpCallback(const HttpRequest &, HttpResponse *resp)
+{
+    resp->setStatusCode(HttpResponse::k404NotFound);
+    resp->setCloseConnection(true);
+}
+} // namespace
+
+HttpServer::HttpServer(EventLoop *loop,
+                       const InetAddress &listenAddr,
+                       const std::string &name,
+                       TcpServer::Option option)
+    : loop_(loop)
+    , server_(loop, listenAddr, name, option)
+    , httpCallback_(defaultHttpCallback)
+    , maxHeaderBytes_(HttpContext::kDefaultMaxHeaderBytes)
+    , maxBodyBytes_(HttpContext::kDefaultMaxBodyBytes)
+    , streamHighWaterMark_(kDefaultStreamHighWaterMark)
+{
+    server_.setConnectionCallback(
+        std::bind(&HttpServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(
+        std::bind(&HttpServer::onMessage, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+}
+
+void HttpServer::start()
+{
+    LOG_INFO << "HttpServer starts listening";
+    server_.start();
+}
+
+void HttpServer::onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        HttpContext context;
+        context.setMaxHeaderBytes(maxHeaderBytes_);
+        context.setMaxBodyBytes(maxBodyBytes_);
+        conn->setContext(context);
+    }
+}
+
+// Handle every complete request in buf, pipelined ones included, then send all the responses at once
+void HttpServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime)
+{
+    if (!conn->connected())
+    {
+        buf->retrieveAll(); // Closing after a response that ended the connection, further requests are dropped
+        return;
+    }
+    HttpContext *context = std::any_cast<HttpContext>(conn->getMutableContext());
+    if (context->streaming())
+    {
+        // Pipelined behind a stream: keep it for later, but stop reading once a full head could be waiting
+        if (buf->readableBytes() > maxHeaderBytes_)
+        {
+            conn->stopRead();
+        }
+        return;
+    }
+    Buffer *output = &t_output;
+
+    for (;;)
+    {
+        HttpContext::ParseResult result = context->parseRequest(buf, receiveTime);
+        if (result == HttpContext::kNeedMore)
+        {
+            break;
+        }
+        if (result == HttpContext::kError)
+        {
+            sendError(conn, context->errorStatus(), output);
+            buf->retrieveAll();
+            return;
+        }
+
+        bool close = onRequest(conn, context->request(), output);
+        buf->retrieve(context->requestBytes());
+        context->reset();
+        if (context->streaming())
+        {
+            return; // Its headers are sent, the rest of the input waits for onStreamFinished
+        }
+        if (close)
+        {
+            conn->send(output);
+            conn->shutdown();
+            buf->retrieveAll();
+            return;
+        }
+        if (buf->readableBytes() == 0)
+        {
+            break;
+        }
+    }
+    if (output->readableBytes() > 0)
+    {
+        conn->send(output);
+    }
+}
+
+bool HttpServer::onRequest(const TcpConnectionPtr &conn, const HttpRequest &req, Buffer *output)
+{
+    HttpResponse response(!req.keepAlive());
+    httpCallback_(req, &response);
+
+    if (response.streamProducer())
+    {
+        if (req.version() == HttpRequest::kHttp10)
+        {
+            response.setCloseConnection(true); // No chunked coding in HTTP/1.0, the end of the connection ends the body
+        }
+        response.appendHeadersToBuffer(output, false);
+        if (req.method() == HttpRequest::kHead)
+        {
+            return response.closeConnection();
+        }
+        conn->send(output);
+        startStream(conn, response.streamProducer(), response.closeConnection());
+        return false;
+    }
+
+    const std::shared_ptr<const std::string> &raw = response.rawResponse();
+    if (raw)
+    {
+        if (output->readableBytes() > 0)
+        {
+            conn->send(output);
+        }
+        conn->send(raw); // One write of the shared bytes, nothing is copied
+        return response.closeConnection();
+    }
+
+    const bool keepAliveHeader = req.version() == HttpRequest::kHttp10 && !response.closeConnection();
+    response.appendHeadersToBuffer(output, keepAliveHeader);
+    if (req.method() != HttpRequest::kHead)
+    {
+        const std::shared_ptr<const std::string> &shared = response.sharedBody();
+        std::string &body = response.body();
+        if (response.hasFileBody())
+        {
+            conn->send(output);
+            // The callback owns the holder, so the descriptor stays open until the range has left the queue
+            std::shared_ptr<const void> holder = response.fileHolder();
+            conn->sendFile(response.fileFd(), response.fileOffset(), response.fileCount(),
+                           [holder](const TcpConnectionPtr &, size_t, size_t) {});
+        }
+        else if (shared)
+        {
+            conn->send(output); // Headers of this and earlier responses go first
+            conn->send(shared);
+        }
+        else if (body.size() > kMaxCopiedBody)
+        {
+            conn->send(output);
+            conn->send(std::move(body));
+        }
+        else
+        {
+            output->append(body.data(), body.size());
+        }
+    }
+    return response.closeConnection();
+}
+
+void HttpServer::sendError(const TcpConnectionPtr &conn, HttpResponse::StatusCode status, Buffer *output)
+{
+    LOG_INFO << "HttpServer bad request from " << conn->peerAddress().toIpPort().c_str() << ": " << static_cast<int>(status);
+    HttpResponse response(true);
+    response.setStatusCode(status);
+    response.appendHeadersToBuffer(output, false);
+    conn->send(output);
+    conn->shutdown();
+}
+
+void HttpServer::startStream(const TcpConnectionPtr &conn, const HttpResponse::StreamProducer &producer, bool close)
+{
+    HttpStreamWriterPtr writer = std::make_shared<HttpStreamWriter>(conn, producer, !close, streamHighWaterMark_);
+    writer->setFinishCallback(std::bind(&HttpServer::onStreamFinished, this, std::placeholders::_1, close));
+    std::any_cast<HttpContext>(conn->getMutableContext())->setStream(writer);
+    // The connection holds the writer through these until the stream ends, the writer only a weak reference back
+    conn->setHighWaterMarkCallback(std::bind(&HttpStreamWriter::pause, writer), streamHighWaterMark_);
+    conn->setWriteCompleteCallback(std::bind(&HttpStreamWriter::resume, writer));
+    writer->start();
+}
+
+void HttpServer::onStreamFinished(const TcpConnectionPtr &conn, bool close)
+{
+    conn->setHighWaterMarkCallback(HighWaterMarkCallback(), streamHighWaterMark_);
+    conn->setWriteCompleteCallback(WriteCompleteCallback());
+    std::any_cast<HttpContext>(conn->getMutableContext())->setStream(nullptr);
+    if (close)
+    {
+        conn->shutdown();
+        return;
+    }
+    conn->startRead();
+    Buffer *input = conn->inputBuffer();
+    if (input->readableBytes() > 0)
+    {
+        onMessage(conn, input, Timestamp::now()); // Requests that arrived during the stream
+    }
+}
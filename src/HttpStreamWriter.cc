@@ -0,0 +1,143 @@
+#include <HttpStreamWriter.h>
+#include <TcpConnection.h>
+#include <EventLoop.h>
+
+HttpStreamWriter::HttpStreamWriter(const TcpConnectionPtr &conn, const Producer &producer, bool chunked, size_t highWaterMark)
+    : loop_(conn->getLoop())
+    , conn_(conn)
+    , producer_(producer)
+    , chunked_(chunked)
+    , highWaterMark_(highWaterMark)
+    , paused_(false)
+    , scheduled_(false)
+    , waiting_(false)
+    , notified_(false)
+    , finished_(false)
+    , bytesWritten_(0)
+{
+}
+
+void HttpStreamWriter::write(const void *data, size_t len)
+{
+    TcpConnectionPtr conn = conn_.lock();
+    if (finished_ || len == 0 || !conn)
+    {
+        return;
+    }
+    bytesWritten_ += len;
+    if (!chunked_)
+    {
+        conn->send(static_cast<const char *>(data), len);
+        return;
+    }
+
+    // "<hex size>\r\n", built backwards
+    static const char kHexDigits[] = "0123456789abcdef";
+    char line[2 * sizeof(size_t) + 2];
+    char *end = line + sizeof line;
+    char *p = end;
+    *--p = '\n';
+    *--p = '\r';
+    size_t n = len;
+    do
+    {
+        *--p = kHexDigits[n % 16];
+        n /= 16;
+    } while (n != 0);
+
+    frame_.append(p, end - p);
+    frame_.append(data, len);
+    frame_.append("\r\n", 2);
+    conn->send(&frame_); // In the loop thread the bytes are written or copied to the output queue, frame_ keeps its storage
+}
+
+void HttpStreamWriter::finish()
+{
+    if (finished_)
+    {
+        return;
+    }
+    finished_ = true;
+    TcpConnectionPtr conn = conn_.lock();
+    if (conn && chunked_)
+    {
+        conn->send("0\r\n\r\n", 5);
+    }
+    schedule(); // The finish callback runs from produce(), never under the producer
+}
+
+void HttpStreamWriter::resume()
+{
+    if (paused_)
+    {
+        paused_ = false;
+        schedule();
+    }
+}
+
+void HttpStreamWriter::notify()
+{
+    loop_->runInLoop(std::bind(&HttpStreamWriter::notifyInLoop, shared_from_this()));
+}
+
+void HttpStreamWriter::notifyInLoop()
+{
+    if (waiting_)
+    {
+        waiting_ = false;
+        schedule();
+    }
+    else
+    {
+        notified_ = true; // Raised while the producer runs: data may have come after it looked
+    }
+}
+
+void HttpStreamWriter::schedule()
+{
+    if (scheduled_ || conn_.expired() || (!finished_ && (paused_ || waiting_)))
+    {
+        return;
+    }
+    scheduled_ = true;
+    loop_->queueInLoop(std::bind(&HttpStreamWriter::produce, shared_from_this()));
+}
+
+void HttpStreamWriter::produce()
+{
+    scheduled_ = false;
+    TcpConnectionPtr conn = conn_.lock();
+    if (!conn || !conn->connected())
+    {
+        return; // The client went away, drop the rest of the body
+    }
+    if (!finished_ && !paused_ && !waiting_ && conn->outputBytes() >= highWaterMark_)
+    {
+        // Already above the mark without a write of ours crossing it, e.g. a file response queued in front of
+        // the stream: no high-water mark callback will come, the write-complete one resumes the producer
+        paused_ = true;
+        return;
+    }
+    if (!finished_ && !paused_ && !waiting_)
+    {
+        const size_t before = bytesWritten_;
+        notified_ = false;
+        producer_(this);
+        if (bytesWritten_ == before && !finished_ && !notified_)
+        {
+            waiting_ = true; // Nothing ready, polling again would only spin the loop
+            return;
+        }
+    }
+    if (finished_)
+    {
+        if (finishCallback_)
+        {
+            FinishCallback cb;
+            cb.swap(finishCallback_);
+            cb(conn);
+        }
+        return;
+    }
+    schedule();
+}
@@ -0,0 +1,98 @@
+#include <IdleReaper.h>
+#include <EventLoop.h>
+#include <Logger.h>
+
+IdleReaper::IdleReaper(EventLoop *loop, int idleSeconds)
+    : loop_(loop)
+    , buckets_(idleSeconds + 1, nullptr)
+    , cursor_(0)
+{
+}
+
+IdleReaper::~IdleReaper()
+{
+    loop_->cancel(timerId_);
+    for (TcpConnection *head : buckets_)
+    {
+        while (head)
+        {
+            TcpConnection *next = head->idleNext_;
+            head->idlePrev_ = nullptr;
+            head->idleNext_ = nullptr;
+            head->idleBucket_ = -1;
+            head->idleReaper_ = nullptr;
+            head = next;
+        }
+    }
+}
+
+void IdleReaper::start()
+{
+    timerId_ = loop_->runEvery(1.0, std::bind(&IdleReaper::onTick, this));
+}
+
+void IdleReaper::remove(TcpConnection *conn)
+{
+    if (conn->idleBucket_ < 0)
+    {
+        return;
+    }
+    if (conn->idlePrev_)
+    {
+        conn->idlePrev_->idleNext_ = conn->idleNext_;
+    }
+    else
+    {
+        buckets_[conn->idleBucket_] = conn->idleNext_;
+    }
+    if (conn->idleNext_)
+    {
+        conn->idleNext_->idlePrev_ = conn->idlePrev_;
+    }
+    conn->idlePrev_ = nullptr;
+    conn->idleNext_ = nullptr;
+    conn->idleBucket_ = -1;
+}
+
+void IdleReaper::link(TcpConnection *conn, int bucket)
+{
+    TcpConnection *head = buckets_[bucket];
+    conn->idlePrev_ = nullptr;
+    conn->idleNext_ = head;
+    if (head)
+    {
+        head->idlePrev_ = conn;
+    }
+    buckets_[bucket] = conn;
+    conn->idleBucket_ = bucket;
+}
+
+// Advance the cursor; the bucket it lands on was last refreshed idleSeconds ago
+void IdleReaper::onTick()
+{
+    const int size = static_cast<int>(buckets_.size());
+    cursor_ = (cursor_ + 1) % size;
+
+    // Connections of this bucket have been quiet for half the idle timeout
+    const int quietSeconds = (size - 1) / 2;
+    if (quietSeconds > 0)
+    {
+        for (TcpConnection *quiet = buckets_[(cursor_ + size - 1 - quietSeconds) % size]; quiet; quiet = quiet->idleNext_)
+        {
+            quiet->releaseIdleBuffers();
+        }
+    }
+
+    TcpConnection *conn = buckets_[cursor_];
+    buckets_[cursor_] = nullptr;
+    while (conn)
+    {
+        TcpConnection *next = conn->idleNext_;
+        conn->idlePrev_ = nullptr;
+        conn->idleNext_ = nullptr;
+        conn->idleBucket_ = -1;
+        LOG_INFO << "IdleReaper closing idle connection " << conn->name().c_str();
+        conn->forceClose(); // Closed in a queued functor, the connection is still owned by TcpServer until then
+        conn = next;
+    }
+}
@@ -0,0 +1,327 @@
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <algorithm>
+
+#include <IoUringPoller.h>
+#include <Logger.h>
+#include <Channel.h>
+
+const int kNew = -1;    // A channel has not yet been added to Poller
+const int kAdded = 1;   // A channel has already been added to Poller
+const int kDeleted = 2; // A channel has been deleted from Poller
+
+// user_data of requests whose completions carry no channel event (POLL_REMOVE)
+const uint64_t kIgnoreUserData = ~0ULL;
+
+static int ioUringSetup(unsigned entries, io_uring_params *p)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, void *arg, size_t argSize)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+bool IoUringPoller::isSupported()
+{
+    static const bool supported = []() {
+        io_uring_params params;
+        ::memset(&params, 0, sizeof(params));
+        int fd = ioUringSetup(2, &params);
+        if (fd < 0)
+        {
+            return false;
+        }
+        ::close(fd);
+        // Timed waits without a timeout SQE need IORING_ENTER_EXT_ARG (Linux 5.11)
+        return (params.features & IORING_FEAT_EXT_ARG) != 0;
+    }();
+    return supported;
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop)
+    , ringFd_(-1)
+    , sqRing_(MAP_FAILED)
+    , cqRing_(MAP_FAILED)
+    , sqRingSize_(0)
+    , cqRingSize_(0)
+    , sqes_(static_cast<io_uring_sqe *>(MAP_FAILED))
+    , sqesSize_(0)
+    , sqPending_(0)
+    , nextGeneration_(0)
+{
+    ::memset(&params_, 0, sizeof(params_));
+    ringFd_ = ioUringSetup(kRingEntries, &params_);
+    if (ringFd_ < 0)
+    {
+        LOG_FATAL << "io_uring_setup error:" << errno;
+    }
+
+    sqRingSize_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+    if (params_.features & IORING_FEAT_SINGLE_MMAP) // Both rings live in one mapping
+    {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED)
+    {
+        LOG_FATAL << "io_uring sq ring mmap error:" << errno;
+    }
+    if (params_.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        cqRing_ = sqRing_;
+    }
+    else
+    {
+        cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED)
+        {
+            LOG_FATAL << "io_uring cq ring mmap error:" << errno;
+        }
+    }
+
+    sqesSize_ = params_.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(
+        ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED)
+    {
+        LOG_FATAL << "io_uring sqes mmap error:" << errno;
+    }
+
+    char *sq = static_cast<char *>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.tail);
+    sqMask_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.ring_mask);
+    sqArray_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.array);
+
+    char *cq = static_cast<char *>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned *>(cq + params_.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned *>(cq + params_.cq_off.tail);
+    cqMask_ = reinterpret_cast<unsigned *>(cq + params_.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params_.cq_off.cqes);
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    if (sqes_ != MAP_FAILED)
+    {
+        ::munmap(sqes_, sqesSize_);
+    }
+    if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_)
+    {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    if (sqRing_ != MAP_FAILED)
+    {
+        ::munmap(sqRing_, sqRingSize_);
+    }
+    ::close(ringFd_); // Closing the ring cancels every poll request still in flight
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    LOG_DEBUG << "fd total count:" << channels_.size();
+
+    // One-shot poll requests that fired last round are re-armed here, after their handlers ran,
+    // so interest changes made by the handlers are picked up without an extra request
+    for (int fd : rearmFds_)
+    {
+        auto it = registrations_.find(fd);
+        if (it != registrations_.end() && !it->second.armed && !it->second.channel->isNoneEvent())
+        {
+            armPoll(it->second);
+        }
+    }
+    rearmFds_.clear();
+
+    // Submit every queued request and wait for completions with a single io_uring_enter
+    bool ready = __atomic_load_n(cqHead_, __ATOMIC_RELAXED) != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    int ret = enter(ready ? 0 : 1, timeoutMs);
+    int saveErrno = errno;
+    Timestamp now(Timestamp::now());
+
+    if (ret < 0 && saveErrno != EINTR && saveErrno != ETIME && saveErrno != EBUSY && saveErrno != EAGAIN)
+    {
+        errno = saveErrno;
+        LOG_ERROR << "IoUringPoller::poll() error!";
+    }
+
+    fillActiveChannels(activeChannels);
+    if (activeChannels->empty())
+    {
+        LOG_DEBUG << "timeout!";
+    }
+    return now;
+}
+
+// channel update remove => EventLoop updateChannel removeChannel => Poller updateChannel removeChannel
+void IoUringPoller::updateChannel(Channel *channel)
+{
+    const int index = channel->index();
+    int fd = channel->fd();
+
+    if (index == kNew || index == kDeleted)
+    {
+        if (index == kNew)
+        {
+            channels_[fd] = channel;
+            registrations_[fd] = Registration{channel, 0, false};
+        }
+        channel->set_index(kAdded);
+        Registration &reg = registrations_[fd];
+        if (!channel->isNoneEvent())
+        {
+            armPoll(reg);
+        }
+    }
+    else // The channel has already been registered in Poller
+    {
+        Registration &reg = registrations_[fd];
+        if (reg.armed)
+        {
+            cancelPoll(reg);
+        }
+        if (channel->isNoneEvent())
+        {
+            channel->set_index(kDeleted);
+        }
+        else
+        {
+            armPoll(reg);
+        }
+    }
+}
+
+// Delete the channel from Poller
+void IoUringPoller::removeChannel(Channel *channel)
+{
+    int fd = channel->fd();
+    channels_.erase(fd);
+
+    auto it = registrations_.find(fd);
+    if (it != registrations_.end())
+    {
+        if (it->second.armed)
+        {
+            cancelPoll(it->second);
+        }
+        registrations_.erase(it);
+    }
+    channel->set_index(kNew);
+}
+
+// Reap the completion queue and fill in active connections
+void IoUringPoller::fillActiveChannels(ChannelList *activeChannels)
+{
+    unsigned head = __atomic_load_n(cqHead_, __ATOMIC_RELAXED);
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    const unsigned mask = *cqMask_;
+
+    for (; head != tail; ++head)
+    {
+        const io_uring_cqe &cqe = cqes_[head & mask];
+        if (cqe.user_data == kIgnoreUserData)
+        {
+            continue;
+        }
+
+        int fd = static_cast<int>(cqe.user_data & 0xffffffffu);
+        uint32_t generation = static_cast<uint32_t>(cqe.user_data >> 32);
+        auto it = registrations_.find(fd);
+        if (it == registrations_.end() || it->second.generation != generation)
+        {
+            continue; // Completion of a request that was cancelled or replaced
+        }
+
+        Registration &reg = it->second;
+        reg.armed = false;
+        rearmFds_.push_back(fd);
+        reg.channel->set_revents(cqe.res < 0 ? static_cast<int>(EPOLLERR) : cqe.res);
+        activeChannels->push_back(reg.channel); // EventLoop now has the list of all channels that have events returned by its Poller
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+}
+
+void IoUringPoller::armPoll(Registration &reg)
+{
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = reg.channel->fd();
+    sqe->poll32_events = static_cast<uint32_t>(reg.channel->events());
+    reg.generation = ++nextGeneration_;
+    sqe->user_data = makeUserData(reg.channel->fd(), reg.generation);
+    reg.armed = true;
+}
+
+void IoUringPoller::cancelPoll(Registration &reg)
+{
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = makeUserData(reg.channel->fd(), reg.generation);
+    sqe->user_data = kIgnoreUserData;
+    reg.armed = false;
+    reg.generation = ++nextGeneration_; // The -ECANCELED completion of the old request is now stale
+}
+
+io_uring_sqe *IoUringPoller::getSqe()
+{
+    unsigned tail = *sqTail_;
+    if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= params_.sq_entries)
+    {
+        enter(0, 0); // Ring is full, hand the queued entries to the kernel first
+    }
+
+    unsigned index = tail & *sqMask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    ::memset(sqe, 0, sizeof(*sqe));
+    sqArray_[index] = index;
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+    ++sqPending_;
+    return sqe;
+}
+
+int IoUringPoller::enter(unsigned minComplete, int timeoutMs)
+{
+    unsigned flags = 0;
+    io_uring_getevents_arg arg;
+    __kernel_timespec ts;
+    void *argp = nullptr;
+    size_t argSize = 0;
+
+    if (minComplete > 0)
+    {
+        flags |= IORING_ENTER_GETEVENTS;
+        if (timeoutMs >= 0)
+        {
+            ts.tv_sec = timeoutMs / 1000;
+            ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+            ::memset(&arg, 0, sizeof(arg));
+            arg.sigmask_sz = _NSIG / 8;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+            flags |= IORING_ENTER_EXT_ARG;
+            argp = &arg;
+            argSize = sizeof(arg);
+        }
+    }
+
+    int ret = ioUringEnter(ringFd_, sqPending_, minComplete, flags, argp, argSize);
+    // Whatever the kernel has not consumed yet stays queued for the next call
+    sqPending_ = *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    return ret;
+}
+
+uint64_t IoUringPoller::makeUserData(int fd, uint32_t generation)
+{
+    return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+}
@@ -0,0 +1,247 @@
+#include <errno.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <unistd.h>
+#include <string.h>
+#include <algorithm>
+
+#include <OutputQueue.h>
+
+OutputQueue::OutputQueue()
+    : bytes_(0)
+    , zeroCopyThreshold_(0)
+    , zeroCopyNextId_(0)
+{
+}
+
+void OutputQueue::append(const char *data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    // Coalesce with the previous small write
+    if (slices_.empty() || slices_.back().type != Slice::kBuffer)
+    {
+        slices_.emplace_back(Slice::kBuffer);
+        slices_.back().buffer.ensureWritableBytes(len > Buffer::kInitialSize ? len : Buffer::kInitialSize);
+    }
+    slices_.back().buffer.append(data, len);
+    bytes_ += len;
+}
+
+void OutputQueue::append(Buffer &&buf)
+{
+    size_t len = buf.readableBytes();
+    if (len == 0)
+    {
+        return;
+    }
+    slices_.emplace_back(Slice::kBuffer);
+    slices_.back().buffer.swap(buf);
+    bytes_ += len;
+}
+
+void OutputQueue::append(const StringPtr &str, size_t offset)
+{
+    if (!str || offset >= str->size())
+    {
+        return;
+    }
+    slices_.emplace_back(Slice::kString);
+    slices_.back().str = str;
+    slices_.back().offset = offset;
+    bytes_ += str->size() - offset;
+}
+
+void OutputQueue::appendFile(int fd, off_t offset, size_t count, const ProgressCallback &progress)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    slices_.emplace_back(Slice::kFile);
+    Slice &slice = slices_.back();
+    slice.fd = fd;
+    slice.fileOffset = offset;
+    slice.fileRemaining = count;
+    slice.fileTotal = count;
+    slice.progress = progress;
+    bytes_ += count;
+}
+
+ssize_t OutputQueue::writeFd(int fd, int *saveErrno)
+{
+    if (slices_.empty())
+    {
+        return 0;
+    }
+
+    ssize_t n = 0;
+    const Slice &head = slices_.front();
+    if (isZeroCopy(head))
+    {
+        struct iovec vec;
+        vec.iov_base = const_cast<char *>(head.data());
+        vec.iov_len = head.size();
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &vec;
+        msg.msg_iovlen = 1;
+        n = ::sendmsg(fd, &msg, MSG_ZEROCOPY);
+        if (n > 0)
+        {
+            pinned_.emplace_back(zeroCopyNextId_++, head.str);
+            return n;
+        }
+        if (n == 0 || errno != ENOBUFS)
+        {
+            if (n < 0)
+            {
+                *saveErrno = errno;
+            }
+            return n;
+        }
+        // ENOBUFS: out of option memory for pinning pages, copy this time
+    }
+
+    if (head.type == Slice::kFile)
+    {
+        off_t offset = head.fileOffset; // retrieve() advances the slice
+        n = ::sendfile(fd, head.fd, &offset, head.fileRemaining < kMaxFileChunk ? head.fileRemaining : kMaxFileChunk);
+        if (n == 0)
+        {
+            errno = EIO; // End of file inside the range, retrying would spin
+            n = -1;
+        }
+    }
+    else
+    {
+        // Gather the memory slices in front of the next file range or zero-copy body
+        struct iovec vec[kMaxIovecs];
+        int iovcnt = 0;
+        for (auto it = slices_.begin(); it != slices_.end() && iovcnt < kMaxIovecs && it->type != Slice::kFile; ++it)
+        {
+            if (iovcnt > 0 && isZeroCopy(*it))
+            {
+                break;
+            }
+            vec[iovcnt].iov_base = const_cast<char *>(it->data());
+            vec[iovcnt].iov_len = it->size();
+            ++iovcnt;
+        }
+        n = ::writev(fd, vec, iovcnt);
+    }
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    return n;
+}
+
+void OutputQueue::retrieve(size_t len)
+{
+    while (len > 0 && !slices_.empty())
+    {
+        Slice &head = slices_.front();
+        size_t size = head.size();
+        if (len < size)
+        {
+            switch (head.type)
+            {
+            case Slice::kBuffer:
+                head.buffer.retrieve(len);
+                break;
+            case Slice::kString:
+                head.offset += len;
+                break;
+            case Slice::kFile:
+                head.fileOffset += len;
+                head.fileRemaining -= len;
+                if (head.progress)
+                {
+                    head.progress(head.fileTotal - head.fileRemaining, head.fileTotal);
+                }
+                break;
+            }
+            bytes_ -= len;
+            return;
+        }
+        len -= size;
+        bytes_ -= size;
+        if (head.type == Slice::kFile && head.progress)
+        {
+            head.progress(head.fileTotal, head.fileTotal);
+        }
+        slices_.pop_front(); // Releases the reference to a shared body
+    }
+}
+
+void OutputQueue::handleZeroCopyCompletions(int fd, bool *copied)
+{
+    for (;;)
+    {
+        char control[128];
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (::recvmsg(fd, &msg, MSG_ERRQUEUE) < 0)
+        {
+            return; // EAGAIN: error queue drained
+        }
+
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                  (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+            {
+                continue;
+            }
+            const struct sock_extended_err *serr = reinterpret_cast<const struct sock_extended_err *>(CMSG_DATA(cm));
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                *copied = true;
+            }
+            // Sends [ee_info, ee_data] completed, ids wrap around at 2^32
+            const uint32_t lo = serr->ee_info;
+            const uint32_t count = serr->ee_data - lo;
+            for (auto it = pinned_.begin(); it != pinned_.end();)
+            {
+                if (it->first - lo <= count)
+                {
+                    it = pinned_.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+    }
+}
+
+std::vector<OutputQueue::StringPtr> OutputQueue::takePinned()
+{
+    std::vector<StringPtr> pinned;
+    pinned.reserve(pinned_.size());
+    for (auto &item : pinned_)
+    {
+        pinned.push_back(std::move(item.second));
+    }
+    pinned_.clear();
+    return pinned;
+}
+
+void OutputQueue::retrieveAll()
+{
+    slices_.clear();
+    bytes_ = 0;
+}
@@ -90,4 +90,12 @@ void Socket::setKeepAlive(bool on)
     // This is very useful for detecting failed peers in the network.
     int optval = on ? 1 : 0;
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof(optval));
+}
+
+bool Socket::setZeroCopy(bool on)
+{
+    // SO_ZEROCOPY lets sendmsg(MSG_ZEROCOPY) pin user pages instead of copying them into the kernel.
+    // Completions are reported on the socket error queue, the pages must not change until then.
+    int optval = on ? 1 : 0;
+    return ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof(optval)) == 0;
 }
\ No newline at end of file
@@ -0,0 +1,556 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <charconv>
+#include <vector>
+
+#include <StaticFileHandler.h>
+#include <Logger.h>
+#include <Timestamp.h>
+
+// Descriptor and stat result of a cached file, closed when the last response using it is done
+struct StaticFileHandler::File
+{
+    int fd;
+    off_t size;
+    ino_t inode;
+    struct timespec mtime;
+    std::string path; // Full path, for revalidation
+    std::string etag;
+    std::string lastModified;
+    std::string_view contentType;
+    mutable std::atomic<int64_t> checkedAt; // Microseconds since epoch of the last stat
+
+    ~File() { ::close(fd); }
+};
+
+namespace
+{
+struct MimeType
+{
+    const char *extension;
+    const char *type;
+};
+
+const MimeType kMimeTypes[] = {
+    {"html", "text/html; charset=utf-8"},
+    {"htm", "text/html; charset=utf-8"},
+    {"css", "text/css"},
+    {"js", "text/javascript"},
+    {"json", "application/json"},
+    {"txt", "text/plain; charset=utf-8"},
+    {"xml", "application/xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"svg", "image/svg+xml"},
+    {"ico", "image/x-icon"},
+    {"webp", "image/webp"},
+    {"pdf", "application/pdf"},
+    {"wasm", "application/wasm"},
+    {"woff2", "font/woff2"},
+    {"mp4", "video/mp4"},
+};
+
+std::string_view contentTypeOf(std::string_view path)
+{
+    size_t dot = path.rfind('.');
+    size_t slash = path.rfind('/');
+    if (dot != std::string_view::npos && (slash == std::string_view::npos || dot > slash))
+    {
+        std::string_view extension = path.substr(dot + 1);
+        for (const MimeType &mime : kMimeTypes)
+        {
+            if (extension.size() == ::strlen(mime.extension) &&
+                ::strncasecmp(extension.data(), mime.extension, extension.size()) == 0)
+            {
+                return mime.type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Percent-decode urlPath and resolve its "." and ".." segments into a path relative to the root,
+// "index.html" appended to directories. False if it is malformed, holds a NUL or climbs above the root
+bool normalizePath(std::string_view urlPath, std::string *path)
+{
+    if (urlPath.empty() || urlPath.front() != '/')
+    {
+        return false;
+    }
+    std::string decoded;
+    decoded.reserve(urlPath.size());
+    for (size_t i = 0; i < urlPath.size(); ++i)
+    {
+        char c = urlPath[i];
+        if (c == '%')
+        {
+            int high = i + 2 < urlPath.size() ? hexValue(urlPath[i + 1]) : -1;
+            int low = high >= 0 ? hexValue(urlPath[i + 2]) : -1;
+            if (low < 0 || (high == 0 && low == 0))
+            {
+                return false;
+            }
+            c = static_cast<char>(high * 16 + low);
+            i += 2;
+        }
+        decoded.push_back(c);
+    }
+
+    std::vector<std::string_view> segments;
+    std::string_view rest(decoded);
+    while (!rest.empty())
+    {
+        size_t slash = rest.find('/');
+        std::string_view segment = rest.substr(0, slash);
+        if (segment == "..")
+        {
+            if (segments.empty())
+            {
+                return false;
+            }
+            segments.pop_back();
+        }
+        else if (!segment.empty() && segment != ".")
+        {
+            segments.push_back(segment);
+        }
+        rest = slash == std::string_view::npos ? std::string_view() : rest.substr(slash + 1);
+    }
+
+    path->clear();
+    for (std::string_view segment : segments)
+    {
+        path->push_back('/');
+        path->append(segment.data(), segment.size());
+    }
+    const char last = decoded.back();
+    const bool directory = last == '/' || (decoded.size() >= 2 && decoded.compare(decoded.size() - 2, 2, "/.") == 0) ||
+                           (decoded.size() >= 3 && decoded.compare(decoded.size() - 3, 3, "/..") == 0);
+    if (directory)
+    {
+        path->append("/index.html");
+    }
+    return true;
+}
+
+// IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+std::string httpDate(time_t seconds)
+{
+    struct tm tm;
+    ::gmtime_r(&seconds, &tm);
+    char buf[32];
+    size_t n = ::strftime(buf, sizeof buf, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return std::string(buf, n);
+}
+
+bool parseHttpDate(std::string_view text, time_t *seconds)
+{
+    char buf[64];
+    if (text.size() >= sizeof buf)
+    {
+        return false;
+    }
+    ::memcpy(buf, text.data(), text.size());
+    buf[text.size()] = '\0';
+    struct tm tm = {};
+    const char *end = ::strptime(buf, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (end == nullptr || *end != '\0')
+    {
+        return false;
+    }
+    *seconds = ::timegm(&tm);
+    return true;
+}
+
+// Whether an If-None-Match list holds etag or "*", compared weakly as RFC 9110 13.1.2 requires
+bool etagListMatches(std::string_view list, std::string_view etag)
+{
+    while (!list.empty())
+    {
+        size_t comma = list.find(',');
+        std::string_view item = list.substr(0, comma);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+        {
+            item.remove_prefix(1);
+        }
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+        {
+            item.remove_suffix(1);
+        }
+        if (item.substr(0, 2) == "W/")
+        {
+            item.remove_prefix(2);
+        }
+        if (item == "*" || item == etag)
+        {
+            return true;
+        }
+        if (comma == std::string_view::npos)
+        {
+            break;
+        }
+        list.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+bool parseNumber(std::string_view text, uint64_t *value)
+{
+    if (text.empty())
+    {
+        return false;
+    }
+    auto result = std::from_chars(text.data(), text.data() + text.size(), *value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+enum RangeResult
+{
+    kWholeFile,     // No range, or one that must be ignored (malformed, several ranges, other units)
+    kPartial,
+    kUnsatisfiable
+};
+
+// A single byte range of a size byte file, as [*first, *last]
+RangeResult parseRange(std::string_view range, uint64_t size, uint64_t *first, uint64_t *last)
+{
+    if (range.size() < 6 || ::strncasecmp(range.data(), "bytes=", 6) != 0)
+    {
+        return kWholeFile;
+    }
+    range.remove_prefix(6);
+    while (!range.empty() && range.front() == ' ')
+    {
+        range.remove_prefix(1);
+    }
+    while (!range.empty() && range.back() == ' ')
+    {
+        range.remove_suffix(1);
+    }
+    size_t dash = range.find('-');
+    if (dash == std::string_view::npos || range.find(',') != std::string_view::npos)
+    {
+        return kWholeFile;
+    }
+
+    std::string_view from = range.substr(0, dash);
+    std::string_view to = range.substr(dash + 1);
+    uint64_t a = 0;
+    uint64_t b = 0;
+    if (from.empty())
+    {
+        // "-n": the last n bytes
+        if (!parseNumber(to, &b))
+        {
+            return kWholeFile;
+        }
+        if (b == 0 || size == 0)
+        {
+            return kUnsatisfiable;
+        }
+        *first = b < size ? size - b : 0;
+        *last = size - 1;
+        return kPartial;
+    }
+    if (!parseNumber(from, &a) || (!to.empty() && (!parseNumber(to, &b) || b < a)))
+    {
+        return kWholeFile;
+    }
+    if (a >= size)
+    {
+        return kUnsatisfiable;
+    }
+    *first = a;
+    *last = to.empty() || b >= size ? size - 1 : b;
+    return kPartial;
+}
+
+void addValidators(HttpResponse *resp, const std::string &etag, const std::string &lastModified)
+{
+    resp->addHeader("ETag", etag);
+    resp->addHeader("Last-Modified", lastModified);
+}
+} // namespace
+
+StaticFileHandler::StaticFileHandler(const std::string &root, size_t cacheEntries)
+    : root_(root)
+    , revalidateMicroSeconds_(1000 * 1000)
+    , cache_(cacheEntries, 0) // One shard per hardware thread, as for the response cache
+    , responseCache_(new ResponseCache(kDefaultResponseCacheEntries, 0))
+    , maxCachedFileSize_(kDefaultMaxCachedFileSize)
+{
+    while (root_.size() > 1 && root_.back() == '/')
+    {
+        root_.pop_back();
+    }
+}
+
+StaticFileHandler::~StaticFileHandler() = default;
+
+void StaticFileHandler::setResponseCache(size_t entries, size_t maxFileSize)
+{
+    // One shard per hardware thread, so io loops rarely contend on the same lock
+    responseCache_.reset(entries > 0 ? new ResponseCache(entries, 0) : nullptr);
+    maxCachedFileSize_ = maxFileSize;
+}
+
+void StaticFileHandler::handle(const HttpRequest &req, HttpResponse *resp)
+{
+    if (req.method() != HttpRequest::kGet && req.method() != HttpRequest::kHead)
+    {
+        resp->setStatusCode(HttpResponse::k405MethodNotAllowed);
+        resp->addHeader("Allow", "GET, HEAD");
+        return;
+    }
+
+    std::string path;
+    if (!normalizePath(req.path(), &path))
+    {
+        resp->setStatusCode(HttpResponse::k403Forbidden);
+        return;
+    }
+    FilePtr file;
+    HttpResponse::StatusCode status = lookup(path, &file);
+    if (status == HttpResponse::k301MovedPermanently)
+    {
+        // A directory without its trailing slash: redirect, so relative links in its index resolve inside it
+        std::string location(req.path());
+        location.push_back('/');
+        if (!req.query().empty())
+        {
+            location.push_back('?');
+            location.append(req.query().data(), req.query().size());
+        }
+        resp->setStatusCode(status);
+        resp->addHeader("Location", location);
+        return;
+    }
+    if (status != HttpResponse::k200Ok)
+    {
+        resp->setStatusCode(status);
+        return;
+    }
+
+    // Conditional GET: If-None-Match wins over If-Modified-Since (RFC 9110 13.2.2)
+    std::string_view ifNoneMatch = req.getHeader("If-None-Match");
+    bool notModified = false;
+    if (!ifNoneMatch.empty())
+    {
+        notModified = etagListMatches(ifNoneMatch, file->etag);
+    }
+    else
+    {
+        std::string_view ifModifiedSince = req.getHeader("If-Modified-Since");
+        time_t since = 0;
+        notModified = !ifModifiedSince.empty() &&
+                      (ifModifiedSince == file->lastModified ||
+                       (parseHttpDate(ifModifiedSince, &since) && file->mtime.tv_sec <= since));
+    }
+    if (notModified)
+    {
+        resp->setStatusCode(HttpResponse::k304NotModified);
+        addValidators(resp, file->etag, file->lastModified);
+        return;
+    }
+
+    const uint64_t size = static_cast<uint64_t>(file->size);
+    std::string_view rangeHeader = req.getHeader("Range");
+    if (responseCache_ && size <= maxCachedFileSize_ && req.method() == HttpRequest::kGet && rangeHeader.empty() &&
+        req.version() == HttpRequest::kHttp11 && !resp->closeConnection())
+    {
+        std::string key(path);
+        key.push_back(' ');
+        key.append(file->etag);
+        RenderedPtr rendered;
+        if (!responseCache_->get(key, rendered))
+        {
+            rendered = renderResponse(*file);
+            if (rendered)
+            {
+                responseCache_->put(key, rendered);
+            }
+        }
+        if (rendered)
+        {
+            resp->setRawResponse(rendered);
+            return;
+        }
+    }
+
+    uint64_t first = 0;
+    uint64_t last = size == 0 ? 0 : size - 1;
+    RangeResult range = kWholeFile;
+    if (!rangeHeader.empty() && req.method() == HttpRequest::kGet)
+    {
+        // If-Range: the range only applies to the representation the client already holds part of
+        std::string_view ifRange = req.getHeader("If-Range");
+        if (ifRange.empty() || ifRange == file->etag || ifRange == file->lastModified)
+        {
+            range = parseRange(rangeHeader, size, &first, &last);
+        }
+    }
+
+    char number[64];
+    if (range == kUnsatisfiable)
+    {
+        resp->setStatusCode(HttpResponse::k416RangeNotSatisfiable);
+        int n = ::snprintf(number, sizeof number, "bytes */%llu", static_cast<unsigned long long>(size));
+        resp->addHeader("Content-Range", std::string_view(number, n));
+        return;
+    }
+
+    addFileHeaders(resp, *file);
+    if (range == kPartial)
+    {
+        resp->setStatusCode(HttpResponse::k206PartialContent);
+        int n = ::snprintf(number, sizeof number, "bytes %llu-%llu/%llu", static_cast<unsigned long long>(first),
+                           static_cast<unsigned long long>(last), static_cast<unsigned long long>(size));
+        resp->addHeader("Content-Range", std::string_view(number, n));
+    }
+    else
+    {
+        resp->setStatusCode(HttpResponse::k200Ok);
+    }
+    if (size > 0)
+    {
+        resp->setFileBody(file->fd, static_cast<off_t>(first), static_cast<size_t>(last - first + 1), file);
+    }
+}
+
+void StaticFileHandler::addFileHeaders(HttpResponse *resp, const File &file)
+{
+    resp->setContentType(file.contentType);
+    addValidators(resp, file.etag, file.lastModified);
+    resp->addHeader("Accept-Ranges", "bytes");
+}
+
+StaticFileHandler::RenderedPtr StaticFileHandler::renderResponse(const File &file)
+{
+    std::string body(static_cast<size_t>(file.size), '\0');
+    size_t done = 0;
+    while (done < body.size())
+    {
+        ssize_t n = ::pread(file.fd, &body[done], body.size() - done, static_cast<off_t>(done));
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            return RenderedPtr(); // Truncated since it was opened, revalidation will notice
+        }
+        done += static_cast<size_t>(n);
+    }
+
+    HttpResponse response(false);
+    response.setStatusCode(HttpResponse::k200Ok);
+    addFileHeaders(&response, file);
+    response.setBody(std::move(body));
+    Buffer output;
+    response.appendHeadersToBuffer(&output, false);
+    output.append(response.body().data(), response.body().size());
+    return std::make_shared<const std::string>(output.retrieveAllAsString());
+}
+
+HttpResponse::StatusCode StaticFileHandler::lookup(const std::string &path, FilePtr *file)
+{
+    FilePtr cached;
+    if (cache_.get(path, cached))
+    {
+        if (fresh(*cached))
+        {
+            *file = std::move(cached);
+            return HttpResponse::k200Ok;
+        }
+        // Changed or gone on disk. Responses still sending the old entry keep its descriptor
+        cache_.remove(path);
+    }
+    return openFile(path, file);
+}
+
+HttpResponse::StatusCode StaticFileHandler::openFile(const std::string &path, FilePtr *file)
+{
+    std::string fullPath = root_ + path;
+    int fd = ::open(fullPath.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+    if (fd < 0)
+    {
+        if (errno == EACCES)
+        {
+            return HttpResponse::k403Forbidden;
+        }
+        if (errno == ENOENT || errno == ENOTDIR)
+        {
+            return HttpResponse::k404NotFound;
+        }
+        LOG_ERROR << "StaticFileHandler open " << fullPath.c_str() << " failed, errno:" << errno;
+        return HttpResponse::k500InternalServerError;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) < 0)
+    {
+        LOG_ERROR << "StaticFileHandler fstat " << fullPath.c_str() << " failed, errno:" << errno;
+        ::close(fd);
+        return HttpResponse::k500InternalServerError;
+    }
+    if (!S_ISREG(st.st_mode))
+    {
+        ::close(fd);
+        return S_ISDIR(st.st_mode) ? HttpResponse::k301MovedPermanently : HttpResponse::k403Forbidden;
+    }
+
+    auto entry = std::make_shared<File>();
+    entry->fd = fd;
+    entry->size = st.st_size;
+    entry->inode = st.st_ino;
+    entry->mtime = st.st_mtim;
+    entry->path = std::move(fullPath);
+    char etag[64];
+    int n = ::snprintf(etag, sizeof etag, "\"%lx-%llx-%llx\"", static_cast<unsigned long>(st.st_ino),
+                       static_cast<unsigned long long>(st.st_size),
+                       static_cast<unsigned long long>(st.st_mtim.tv_sec) * 1000000000ULL + st.st_mtim.tv_nsec);
+    entry->etag.assign(etag, n);
+    entry->lastModified = httpDate(st.st_mtim.tv_sec);
+    entry->contentType = contentTypeOf(path);
+    entry->checkedAt.store(Timestamp::now().microSecondsSinceEpoch(), std::memory_order_relaxed);
+
+    cache_.put(path, entry);
+    *file = std::move(entry);
+    return HttpResponse::k200Ok;
+}
+
+bool StaticFileHandler::fresh(const File &file)
+{
+    const int64_t now = Timestamp::now().microSecondsSinceEpoch();
+    if (now - file.checkedAt.load(std::memory_order_relaxed) < revalidateMicroSeconds_)
+    {
+        return true;
+    }
+    struct stat st;
+    if (::stat(file.path.c_str(), &st) < 0 || st.st_ino != file.inode || st.st_size != file.size ||
+        st.st_mtim.tv_sec != file.mtime.tv_sec || st.st_mtim.tv_nsec != file.mtime.tv_nsec)
+    {
+        return false;
+    }
+    file.checkedAt.store(now, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,208 @@
+#include <string.h>
+
+#include <StringSearch.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SEARCH_HAVE_X86 1 // SSE2 is part of x86-64, AVX2 is checked at runtime
+#endif
+
+namespace search
+{
+namespace
+{
+const size_t kMaxSimdSet = 8; // Larger sets compare too many times per block, the lookup table wins
+
+const char *findCRLFScalar(const char *begin, const char *end)
+{
+    for (const char *p = begin; p + 1 < end; ++p)
+    {
+        if (p[0] == '\r' && p[1] == '\n')
+        {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+const char *findAnyScalar(const char *begin, const char *end, const char *set, size_t setSize)
+{
+    bool table[256] = {false};
+    for (size_t i = 0; i < setSize; ++i)
+    {
+        table[static_cast<unsigned char>(set[i])] = true;
+    }
+    for (const char *p = begin; p < end; ++p)
+    {
+        if (table[static_cast<unsigned char>(*p)])
+        {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+#ifdef SEARCH_HAVE_X86
+// Each step compares the block at p with '\r' and the block at p + 1 with '\n', a CRLF at p + i sets both bit i
+const char *findCRLFSse2(const char *begin, const char *end)
+{
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const char *p = begin;
+    for (; end - p >= 17; p += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 1));
+        int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, cr), _mm_cmpeq_epi8(b, lf)));
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findCRLFScalar(p, end);
+}
+
+__attribute__((target("avx2")))
+const char *findCRLFAvx2(const char *begin, const char *end)
+{
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const char *p = begin;
+    for (; end - p >= 33; p += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, cr), _mm256_cmpeq_epi8(b, lf))));
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findCRLFSse2(p, end);
+}
+
+const char *findAnySse2(const char *begin, const char *end, const char *set, size_t setSize)
+{
+    __m128i needles[kMaxSimdSet];
+    for (size_t i = 0; i < setSize; ++i)
+    {
+        needles[i] = _mm_set1_epi8(set[i]);
+    }
+    const char *p = begin;
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i hits = _mm_setzero_si128();
+        for (size_t i = 0; i < setSize; ++i)
+        {
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[i]));
+        }
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findAnyScalar(p, end, set, setSize);
+}
+
+__attribute__((target("avx2")))
+const char *findAnyAvx2(const char *begin, const char *end, const char *set, size_t setSize)
+{
+    __m256i needles[kMaxSimdSet];
+    for (size_t i = 0; i < setSize; ++i)
+    {
+        needles[i] = _mm256_set1_epi8(set[i]);
+    }
+    const char *p = begin;
+    for (; end - p >= 32; p += 32)
+    {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i hits = _mm256_setzero_si256();
+        for (size_t i = 0; i < setSize; ++i)
+        {
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, needles[i]));
+        }
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findAnySse2(p, end, set, setSize);
+}
+#endif
+
+Impl detectImpl()
+{
+#ifdef SEARCH_HAVE_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? kAvx2 : kSse2;
+#else
+    return kScalar;
+#endif
+}
+
+// Zero-initialized to kScalar before dynamic initialization, so calls from other static initializers are still safe
+const Impl gBestImpl = detectImpl();
+} // namespace
+
+Impl bestImpl()
+{
+    return gBestImpl;
+}
+
+const char *findCRLF(Impl impl, const char *begin, const char *end)
+{
+    switch (impl)
+    {
+#ifdef SEARCH_HAVE_X86
+    case kAvx2:
+        return findCRLFAvx2(begin, end);
+    case kSse2:
+        return findCRLFSse2(begin, end);
+#endif
+    default:
+        return findCRLFScalar(begin, end);
+    }
+}
+
+const char *findAny(Impl impl, const char *begin, const char *end, const char *set, size_t setSize)
+{
+    if (setSize > kMaxSimdSet)
+    {
+        return findAnyScalar(begin, end, set, setSize);
+    }
+    switch (impl)
+    {
+#ifdef SEARCH_HAVE_X86
+    case kAvx2:
+        return findAnyAvx2(begin, end, set, setSize);
+    case kSse2:
+        return findAnySse2(begin, end, set, setSize);
+#endif
+    default:
+        return findAnyScalar(begin, end, set, setSize);
+    }
+}
+
+const char *findCRLF(const char *begin, const char *end)
+{
+    return findCRLF(gBestImpl, begin, end);
+}
+
+const char *findEOL(const char *begin, const char *end)
+{
+    return findChar(begin, end, '\n');
+}
+
+const char *findChar(const char *begin, const char *end, char c)
+{
+    return static_cast<const char *>(::memchr(begin, c, end - begin));
+}
+
+const char *findAny(const char *begin, const char *end, const char *set, size_t setSize)
+{
+    return findAny(gBestImpl, begin, end, set, setSize);
+}
+} // namespace search
@@ -6,7 +6,7 @@
 #include <string.h>
 #include <netinet/tcp.h>
 #include <sys/sendfile.h>
-#include <fcntl.h> // for open
+#include <fcntl.h> // for open, pipe2, splice
 #include <unistd.h> // for close
 
 #include <TcpConnection.h>
@@ -14,6 +14,7 @@
 #include <Socket.h>
 #include <Channel.h>
 #include <EventLoop.h>
+#include <IdleReaper.h>
 
 static EventLoop *CheckLoopNotNull(EventLoop *loop)
 {
@@ -33,11 +34,18 @@ TcpConnection::TcpConnection(EventLoop *loop,
     , name_(nameArg)
     , state_(kConnecting)
     , reading_(true)
+    , inputPaused_(false)
     , socket_(new Socket(sockfd))
     , channel_(new Channel(loop, sockfd))
     , localAddr_(localAddr)
     , peerAddr_(peerAddr)
     , highWaterMark_(64 * 1024 * 1024) // 64M
+    , inputHighWaterMark_(0)
+    , idleReaper_(nullptr)
+    , idlePrev_(nullptr)
+    , idleNext_(nullptr)
+    , idleBucket_(-1)
+    , zeroCopyDeadline_(0)
 {
     // Below, set the corresponding callback functions for the channel. The poller notifies the channel that an interested event has occurred, and the channel will call the corresponding callback function.
     channel_->setReadCallback(
@@ -56,6 +64,11 @@ TcpConnection::TcpConnection(EventLoop *loop,
 TcpConnection::~TcpConnection()
 {
     LOG_INFO<<"TcpConnection::dtor["<<name_.c_str()<<"]at fd="<<channel_->fd()<<"state="<<(int)state_;
+    if (forward_)
+    {
+        ::close(forward_->fds[0]);
+        ::close(forward_->fds[1]);
+    }
 }
 
 void TcpConnection::send(const std::string &buf)
@@ -67,9 +80,84 @@ void TcpConnection::send(const std::string &buf)
             sendInLoop(buf.c_str(), buf.size());
         }
         else
+        {
+            // buf may be gone by the time the loop runs the task, so the task owns a copy
+            loop_->runInLoop(
+                std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), buf));
+        }
+    }
+}
+
+void TcpConnection::send(std::string &&buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendStringInLoop(buf);
+        }
+        else
+        {
+            // The string is moved into the task, and from the task into outputQueue_ if it is not written at once
+            loop_->runInLoop(
+                std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), std::move(buf)));
+        }
+    }
+}
+
+void TcpConnection::send(const char *data, size_t len)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(data, len);
+        }
+        else
+        {
+            loop_->runInLoop(
+                std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), std::string(data, len)));
+        }
+    }
+}
+
+void TcpConnection::send(Buffer *buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(buf->peek(), buf->readableBytes());
+            buf->retrieveAll();
+        }
+        else
+        {
+            // Take the storage of buf instead of copying it, buf is left empty
+            Buffer owned(0);
+            owned.swap(*buf);
+            loop_->runInLoop(
+                std::bind(&TcpConnection::sendBufferInLoop, shared_from_this(), std::move(owned)));
+        }
+    }
+}
+
+void TcpConnection::send(const std::shared_ptr<const std::string> &body)
+{
+    send(std::string(), body);
+}
+
+void TcpConnection::send(const std::string &header, const std::shared_ptr<const std::string> &body)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendSharedInLoop(header, body);
+        }
+        else
         {
             loop_->runInLoop(
-                std::bind(&TcpConnection::sendInLoop, this, buf.c_str(), buf.size()));
+                std::bind(&TcpConnection::sendSharedInLoop, shared_from_this(), header, body));
         }
     }
 }
@@ -89,7 +177,7 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
     }
 
     // Indicates that the channel_ is writing data for the first time or the buffer has no data to send.
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    if (!channel_->isWriting() && outputQueue_.readableBytes() == 0)
     {
         nwrote = ::write(channel_->fd(), data, len);
         if (nwrote >= 0)
@@ -120,18 +208,18 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
      * Then register the EPOLLOUT event for the channel. When the poller finds that the TCP send buffer has space, it will notify
      * the corresponding sock->channel and call the channel's registered writeCallback_ callback method.
      * The channel's writeCallback_ is actually the handleWrite callback set by TcpConnection,
-     * which sends all the content of the send buffer outputBuffer_.
+     * which sends all the content of the output queue outputQueue_.
      **/
     if (!faultError && remaining > 0)
     {
         // The current length of data remaining to be sent in the send buffer.
-        size_t oldLen = outputBuffer_.readableBytes();
+        size_t oldLen = outputQueue_.readableBytes();
         if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
         {
             loop_->queueInLoop(
                 std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
         }
-        outputBuffer_.append((char *)data + nwrote, remaining);
+        outputQueue_.append((char *)data + nwrote, remaining);
         if (!channel_->isWriting())
         {
             channel_->enableWriting(); // Here, the channel's write event must be registered, otherwise the poller will not notify the channel of epollout.
@@ -139,6 +227,352 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
     }
 }
 
+// Small strings are cheaper to copy; larger ones are moved into a shared slice so the unsent tail is never copied
+void TcpConnection::sendStringInLoop(std::string &buf)
+{
+    if (buf.size() < kMinSharedBytes)
+    {
+        sendInLoop(buf.data(), buf.size());
+        return;
+    }
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR<<"disconnected, give up writing";
+        return;
+    }
+    size_t oldLen = outputQueue_.readableBytes();
+    outputQueue_.append(std::make_shared<const std::string>(std::move(buf)));
+    sendQueuedInLoop(oldLen);
+}
+
+void TcpConnection::sendBufferInLoop(Buffer &buf)
+{
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR<<"disconnected, give up writing";
+        return;
+    }
+    size_t oldLen = outputQueue_.readableBytes();
+    outputQueue_.append(std::move(buf));
+    sendQueuedInLoop(oldLen);
+}
+
+/**
+ * Queue header (copied) and body (referenced) behind the pending output, then flush as much as the socket takes
+ * with one writev. Whatever is left stays referenced in outputQueue_ until EPOLLOUT, the body is never copied.
+ **/
+void TcpConnection::sendSharedInLoop(const std::string &header, const std::shared_ptr<const std::string> &body)
+{
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR<<"disconnected, give up writing";
+        return;
+    }
+
+    size_t oldLen = outputQueue_.readableBytes();
+    outputQueue_.append(header.data(), header.size());
+    outputQueue_.append(body);
+    sendQueuedInLoop(oldLen);
+}
+
+// Flush data just added to outputQueue_ (oldLen bytes were pending before) and register EPOLLOUT for what is left.
+// A single writeFd stops in front of a file range or zero-copy body, so keep writing until the socket is full or
+// kMaxWriteBytesPerCall is reached. Enabling EPOLLOUT reports a writable socket even when edge-triggered
+void TcpConnection::sendQueuedInLoop(size_t oldLen)
+{
+    if (!channel_->isWriting() && oldLen == 0)
+    {
+        int savedErrno = 0;
+        ssize_t n = 0;
+        size_t written = 0;
+        while ((n = outputQueue_.writeFd(channel_->fd(), &savedErrno)) > 0)
+        {
+            outputQueue_.retrieve(n);
+            written += n;
+            if (outputQueue_.empty() || written >= kMaxWriteBytesPerCall)
+            {
+                break;
+            }
+        }
+        if (n >= 0)
+        {
+            if (outputQueue_.empty())
+            {
+                if (writeCompleteCallback_)
+                {
+                    loop_->queueInLoop(
+                        std::bind(writeCompleteCallback_, shared_from_this()));
+                }
+                return;
+            }
+        }
+        else if (savedErrno != EWOULDBLOCK)
+        {
+            LOG_ERROR<<"TcpConnection::sendQueuedInLoop";
+            if (savedErrno == EPIPE || savedErrno == ECONNRESET) // SIGPIPE RESET
+            {
+                outputQueue_.retrieveAll();
+                return;
+            }
+        }
+    }
+
+    size_t newLen = outputQueue_.readableBytes();
+    if (newLen >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
+    {
+        loop_->queueInLoop(
+            std::bind(highWaterMarkCallback_, shared_from_this(), newLen));
+    }
+    if (!channel_->isWriting())
+    {
+        channel_->enableWriting();
+    }
+}
+
+void TcpConnection::forwardTo(const TcpConnectionPtr &dest)
+{
+    loop_->runInLoop(
+        std::bind(&TcpConnection::forwardToInLoop, shared_from_this(), dest));
+}
+
+void TcpConnection::forwardToInLoop(const TcpConnectionPtr &dest)
+{
+    if (dest->getLoop() != loop_)
+    {
+        LOG_ERROR<<"TcpConnection::forwardTo ["<<name_.c_str()<<"] - destination belongs to another loop";
+        return;
+    }
+    if (forward_ || state_ != kConnected)
+    {
+        LOG_ERROR<<"TcpConnection::forwardTo ["<<name_.c_str()<<"] - already forwarding or not connected";
+        return;
+    }
+
+    std::unique_ptr<ForwardPipe> forward(new ForwardPipe());
+    if (::pipe2(forward->fds, O_NONBLOCK | O_CLOEXEC) < 0)
+    {
+        LOG_ERROR<<"TcpConnection::forwardTo pipe2 error:"<<errno;
+        return;
+    }
+    int capacity = ::fcntl(forward->fds[0], F_GETPIPE_SZ);
+    forward->capacity = capacity > 0 ? capacity : 65536;
+    forward->dest = dest;
+    forward->bytes = 0;
+    forward->eof = false;
+    forward_ = std::move(forward);
+    dest->forwardSource_ = shared_from_this();
+
+    // Bytes read before forwarding started go out first, the pipe is only drained behind dest's queued output
+    if (inputBuffer_.readableBytes() > 0)
+    {
+        dest->send(&inputBuffer_);
+    }
+}
+
+// Splice what the peer sent into the pipe, then push the pipe to the destination
+void TcpConnection::handleForwardRead()
+{
+    for (;;)
+    {
+        if (state_ == kDisconnected)
+        {
+            return;
+        }
+        ssize_t n = -1;
+        int savedErrno = EAGAIN;
+        if (forward_->bytes < forward_->capacity)
+        {
+            n = ::splice(channel_->fd(), nullptr, forward_->fds[1], nullptr, forward_->capacity - forward_->bytes,
+                         SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n > 0)
+            {
+                forward_->bytes += n;
+            }
+            else if (n < 0)
+            {
+                savedErrno = errno;
+            }
+        }
+
+        if (n == 0) // Client disconnected
+        {
+            forward_->eof = true;
+        }
+        else if (n < 0 && savedErrno != EAGAIN)
+        {
+            errno = savedErrno;
+            LOG_ERROR<<"TcpConnection::handleForwardRead";
+            handleError();
+        }
+        drainForwardPipe();
+
+        // Edge-triggered: go on until the socket reports EAGAIN, unless the destination is backed up (reading paused)
+        if (!channel_->isEdgeTriggered() || n <= 0 || !channel_->isReading())
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * Move the pipe into the destination socket. If the destination cannot take everything, stop reading this
+ * connection and let the destination's handleWrite call back here on EPOLLOUT: the pipe never holds more
+ * than its capacity and the source peer sees a closed TCP window.
+ **/
+void TcpConnection::drainForwardPipe()
+{
+    TcpConnectionPtr dest = forward_->dest;
+    if (state_ == kDisconnected || !dest)
+    {
+        return; // dest is dropped once either side is closed or destroyed
+    }
+    if (forward_->bytes > 0 && dest->outputQueue_.empty())
+    {
+        while (forward_->bytes > 0)
+        {
+            ssize_t n = ::splice(forward_->fds[0], nullptr, dest->channel_->fd(), nullptr, forward_->bytes,
+                                 SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n > 0)
+            {
+                forward_->bytes -= n;
+            }
+            else
+            {
+                if (n < 0 && errno != EAGAIN)
+                {
+                    LOG_ERROR<<"TcpConnection::drainForwardPipe";
+                    dest->forceClose();
+                    forceClose();
+                    return;
+                }
+                break;
+            }
+        }
+    }
+
+    if (forward_->bytes > 0)
+    {
+        if (!dest->channel_->isWriting())
+        {
+            dest->channel_->enableWriting();
+        }
+    }
+    else
+    {
+        if (dest->channel_->isWriting() && dest->outputQueue_.empty())
+        {
+            dest->channel_->disableWriting();
+        }
+        if (forward_->eof)
+        {
+            // Pass the half-close on. The other direction may still be in use: this connection is only closed
+            // once its own write side has been shut down too
+            dest->shutdown();
+            if (closeIfForwardDone())
+            {
+                return;
+            }
+        }
+    }
+    updateReading(); // Paused while the pipe holds bytes or after EOF
+}
+
+/**
+ * A forwarding source whose EOF has been passed on no longer watches EPOLLIN, and once its output is drained no
+ * EPOLLOUT either: the poller drops the fd and no EPOLLHUP would ever come. Close it when its own write side has
+ * been shut down as well, as happens to both sides of a two-way proxy (A.forwardTo(B), B.forwardTo(A))
+ **/
+bool TcpConnection::closeIfForwardDone()
+{
+    if (forward_ && forward_->eof && forward_->bytes == 0 && state_ == kDisconnecting && !channel_->isWriting())
+    {
+        handleClose();
+        return true;
+    }
+    return false;
+}
+
+void TcpConnection::startRead()
+{
+    loop_->runInLoop(
+        std::bind(&TcpConnection::startReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::startReadInLoop()
+{
+    reading_ = true;
+    if (inputPaused_ && inputBuffer_.readableBytes() <= inputHighWaterMark_ / 2)
+    {
+        inputPaused_ = false;
+    }
+    updateReading();
+}
+
+void TcpConnection::stopRead()
+{
+    loop_->runInLoop(
+        std::bind(&TcpConnection::stopReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::stopReadInLoop()
+{
+    reading_ = false;
+    updateReading();
+}
+
+void TcpConnection::consumeInput(size_t len)
+{
+    loop_->runInLoop(
+        std::bind(&TcpConnection::consumeInputInLoop, shared_from_this(), len));
+}
+
+void TcpConnection::consumeInputInLoop(size_t len)
+{
+    inputBuffer_.retrieve(len < inputBuffer_.readableBytes() ? len : inputBuffer_.readableBytes());
+    // Hysteresis: resume at half the high-water mark, so a consumer retrieving a few bytes at a time does not toggle EPOLLIN each time
+    if (inputPaused_ && inputBuffer_.readableBytes() <= inputHighWaterMark_ / 2)
+    {
+        inputPaused_ = false;
+        updateReading();
+    }
+}
+
+/**
+ * Apply the read interest: the application wants to read (startRead/stopRead), the input is below its high-water mark,
+ * and no forwarding pipe is backed up. The channel only watches EPOLLIN when all hold, so the kernel socket buffer
+ * fills up and TCP flow control slows the peer down.
+ **/
+void TcpConnection::updateReading()
+{
+    if (state_ != kConnected && state_ != kDisconnecting)
+    {
+        return;
+    }
+    bool wantRead = reading_ && !inputPaused_ && !(forward_ && (forward_->bytes > 0 || forward_->eof));
+    if (wantRead && !channel_->isReading())
+    {
+        channel_->enableReading();
+        if (channel_->isEdgeTriggered())
+        {
+            // Bytes that arrived while reading was off raise no new edge
+            loop_->queueInLoop(
+                std::bind(&TcpConnection::handleResumedRead, shared_from_this()));
+        }
+    }
+    else if (!wantRead && channel_->isReading())
+    {
+        channel_->disableReading();
+    }
+}
+
+void TcpConnection::handleResumedRead()
+{
+    if (channel_->isReading() && (state_ == kConnected || state_ == kDisconnecting))
+    {
+        handleRead(Timestamp::now());
+    }
+}
+
 void TcpConnection::shutdown()
 {
     if (state_ == kConnected)
@@ -151,9 +585,28 @@ void TcpConnection::shutdown()
 
 void TcpConnection::shutdownInLoop()
 {
-    if (!channel_->isWriting()) // Indicates that all data in the current outputBuffer_ has been sent outside
+    if (!channel_->isWriting()) // Indicates that all data in the current outputQueue_ has been sent outside
     {
         socket_->shutdownWrite();
+        closeIfForwardDone();
+    }
+}
+
+void TcpConnection::forceClose()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        setState(kDisconnecting);
+        loop_->queueInLoop(
+            std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    }
+}
+
+void TcpConnection::forceCloseInLoop()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        handleClose(); // Same path as a peer close: connection callback, then TcpServer::removeConnection
     }
 }
 
@@ -163,6 +616,10 @@ void TcpConnection::connectEstablished()
     setState(kConnected);
     channel_->tie(shared_from_this());
     channel_->enableReading(); // Register the channel's EPOLLIN read event with the poller
+    if (idleReaper_)
+    {
+        idleReaper_->touch(this);
+    }
 
     // New connection established, execute callback
     connectionCallback_(shared_from_this());
@@ -176,41 +633,168 @@ void TcpConnection::connectDestroyed()
         channel_->disableAll(); // Remove all interested events of the channel from the poller
         connectionCallback_(shared_from_this());
     }
+    if (idleReaper_)
+    {
+        idleReaper_->remove(this);
+        idleReaper_ = nullptr;
+    }
+    if (forward_)
+    {
+        forward_->dest.reset(); // ~TcpServer destroys connections without handleClose, break a forwarding cycle here too
+    }
     channel_->remove(); // Remove the channel from the poller
+    if (outputQueue_.hasPinned())
+    {
+        // The kernel may still read pinned zero-copy bodies: keep the socket open, and this connection alive,
+        // until their completions have been read from the error queue
+        zeroCopyDeadline_ = Timestamp::now().microSecondsSinceEpoch() + kZeroCopyLingerSeconds * 1000 * 1000;
+        loop_->runAfter(kZeroCopyPollSeconds,
+                        std::bind(&TcpConnection::reapZeroCopyCompletions, shared_from_this()));
+    }
+}
+
+// A removed channel gets no EPOLLERR, and a closed socket would report EPOLLHUP on every poll anyway, so the
+// error queue of a destroyed connection is polled on a timer instead
+void TcpConnection::reapZeroCopyCompletions()
+{
+    bool copied = false;
+    outputQueue_.handleZeroCopyCompletions(socket_->fd(), &copied);
+    if (!outputQueue_.hasPinned())
+    {
+        return; // The socket is closed along with this connection
+    }
+    if (Timestamp::now().microSecondsSinceEpoch() < zeroCopyDeadline_)
+    {
+        loop_->runAfter(kZeroCopyPollSeconds,
+                        std::bind(&TcpConnection::reapZeroCopyCompletions, shared_from_this()));
+        return;
+    }
+    // The peer has not taken the data for too long: reset the connection, which makes the kernel drop its
+    // send queue and the page references of the pinned bodies, and only then let the bodies go
+    LOG_INFO<<"TcpConnection::reapZeroCopyCompletions ["<<name_.c_str()<<"] - send queue not drained, resetting";
+    struct linger abortive = {1, 0};
+    ::setsockopt(socket_->fd(), SOL_SOCKET, SO_LINGER, &abortive, sizeof abortive);
+    socket_.reset();
+    outputQueue_.takePinned();
+}
+
+void TcpConnection::setZeroCopyThreshold(size_t threshold)
+{
+    if (threshold > 0 && !socket_->setZeroCopy(true))
+    {
+        LOG_ERROR<<"TcpConnection::setZeroCopyThreshold - SO_ZEROCOPY not supported";
+        threshold = 0;
+    }
+    outputQueue_.setZeroCopyThreshold(threshold);
+}
+
+// Output needs no counterpart: queue slices are freed as soon as they are written
+void TcpConnection::releaseIdleBuffers()
+{
+    if (inputBuffer_.readableBytes() == 0 && inputBuffer_.capacity() > 0)
+    {
+        inputBuffer_.shrink(0); // The next read lands in the loop's extra buffer first and regrows from there
+    }
+}
+
+void TcpConnection::setEdgeTriggered(bool on)
+{
+    channel_->setEdgeTriggered(on);
 }
 
 // Reading is relative to the server. When the client on the other side has data arriving, the server detects EPOLLIN and triggers the callback on this fd. handleRead reads the data sent by the other side.
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
-    int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
-    if (n > 0) // Data has arrived
+    if (idleReaper_)
     {
-        // A readable event has occurred for an established connection user, call the user-provided callback operation onMessage. shared_from_this gets a smart pointer to TcpConnection.
-        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        idleReaper_->touch(this); // Only relinks the connection, no allocation
     }
-    else if (n == 0) // Client disconnected
+    if (forward_)
     {
-        handleClose();
+        handleForwardRead();
+        return;
     }
-    else // An error occurred
+    int savedErrno = 0;
+    ssize_t n = 0;
+    for (;;)
     {
-        errno = savedErrno;
-        LOG_ERROR<<"TcpConnection::handleRead";
-        handleError();
+        ssize_t total = 0;
+        // In edge-triggered mode the socket must be drained until EAGAIN, otherwise no further EPOLLIN is reported.
+        // Stop early at the input high-water mark, the application gets to consume first
+        do
+        {
+            n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+            if (n > 0)
+            {
+                total += n;
+            }
+        } while (n > 0 && channel_->isEdgeTriggered() && !inputAboveHighWaterMark());
+
+        if (total > 0) // Data has arrived
+        {
+            // A readable event has occurred for an established connection user, call the user-provided callback operation onMessage. shared_from_this gets a smart pointer to TcpConnection.
+            messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+            if (inputBuffer_.readableBytes() == 0)
+            {
+                inputBuffer_.trim(); // Let capacity left by an earlier burst decay
+            }
+        }
+        if (n == 0) // Client disconnected
+        {
+            handleClose();
+            return;
+        }
+        if (n < 0 && !(channel_->isEdgeTriggered() && savedErrno == EAGAIN)) // An error occurred
+        {
+            errno = savedErrno;
+            LOG_ERROR<<"TcpConnection::handleRead";
+            handleError();
+            return;
+        }
+        if (inputAboveHighWaterMark()) // The application does not keep up, stop reading until it consumes its input
+        {
+            inputPaused_ = true;
+            updateReading();
+            return;
+        }
+        if (n < 0 || !channel_->isEdgeTriggered() || !channel_->isReading())
+        {
+            return;
+        }
+        // Edge-triggered and stopped at the high-water mark, but the callback consumed the input: the socket is not drained yet
     }
 }
 
 void TcpConnection::handleWrite()
 {
+    if (channel_->isWriting() && outputQueue_.empty())
+    {
+        // Only a forwarding pipe is waiting for this socket
+        TcpConnectionPtr source = forwardSource_.lock();
+        if (source && source->forward_)
+        {
+            source->drainForwardPipe();
+        }
+        else
+        {
+            channel_->disableWriting();
+        }
+        return;
+    }
     if (channel_->isWriting())
     {
         int savedErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
-        if (n > 0)
+        ssize_t n = outputQueue_.writeFd(channel_->fd(), &savedErrno);
+        if (n > 0 && idleReaper_)
+        {
+            idleReaper_->touch(this); // A peer that keeps draining our output is not idle
+        }
+        size_t written = 0;
+        while (n > 0)
         {
-            outputBuffer_.retrieve(n);//Retrieve data from the buffer and move the readindex pointer
-            if (outputBuffer_.readableBytes() == 0)
+            outputQueue_.retrieve(n);//Retrieve data from the buffer and move the readindex pointer
+            written += n;
+            if (outputQueue_.readableBytes() == 0)
             {
                 channel_->disableWriting();
                 if (writeCompleteCallback_)
@@ -223,11 +807,32 @@ void TcpConnection::handleWrite()
                 {
                     shutdownInLoop(); // Remove TcpConnection from its current loop
                 }
+                TcpConnectionPtr source = forwardSource_.lock();
+                if (source && source->forward_)
+                {
+                    source->drainForwardPipe(); // Forwarded bytes wait behind the queued output
+                }
+                return;
             }
+            if (!channel_->isEdgeTriggered())
+            {
+                return; // Level-triggered: wait for the next EPOLLOUT
+            }
+            if (written >= kMaxWriteBytesPerCall)
+            {
+                // The socket may still be writable, which raises no new edge: come back after the other channels
+                loop_->queueInLoop(
+                    std::bind(&TcpConnection::handleWrite, shared_from_this()));
+                return;
+            }
+            // Edge-triggered: the next EPOLLOUT only comes after the socket send buffer has been filled
+            n = outputQueue_.writeFd(channel_->fd(), &savedErrno);
         }
-        else
+        if (n < 0 && savedErrno != EAGAIN)
         {
+            errno = savedErrno;
             LOG_ERROR<<"TcpConnection::handleWrite";
+            forceClose(); // Peer reset, or a file shorter than its range: EPOLLOUT would keep firing
         }
     }
     else
@@ -241,6 +846,20 @@ void TcpConnection::handleClose()
     LOG_INFO<<"TcpConnection::handleClose fd="<<channel_->fd()<<"state="<<(int)state_;
     setState(kDisconnected);
     channel_->disableAll();
+    if (idleReaper_)
+    {
+        idleReaper_->remove(this);
+        idleReaper_ = nullptr;
+    }
+    if (forward_)
+    {
+        forward_->dest.reset(); // Two connections forwarding to each other would keep each other alive
+    }
+    TcpConnectionPtr source = forwardSource_.lock();
+    if (source)
+    {
+        source->forceClose(); // Nowhere to forward to anymore
+    }
 
     TcpConnectionPtr connPtr(shared_from_this());
     connectionCallback_(connPtr); // Connection callback
@@ -249,6 +868,19 @@ void TcpConnection::handleClose()
 
 void TcpConnection::handleError()
 {
+    bool zeroCopyCompletion = false;
+    if (outputQueue_.hasPinned()) // EPOLLERR also announces MSG_ZEROCOPY completions on the error queue
+    {
+        zeroCopyCompletion = true;
+        bool copied = false;
+        outputQueue_.handleZeroCopyCompletions(channel_->fd(), &copied);
+        if (copied && outputQueue_.zeroCopyThreshold() > 0)
+        {
+            LOG_INFO<<"TcpConnection::handleError name:"<<name_.c_str()<<" - zero-copy send was copied, disabled";
+            outputQueue_.setZeroCopyThreshold(0);
+        }
+    }
+
     int optval;
     socklen_t optlen = sizeof optval;
     int err = 0;
@@ -260,56 +892,47 @@ void TcpConnection::handleError()
     {
         err = optval;
     }
+    if (err == 0 && zeroCopyCompletion)
+    {
+        return; // Not an error
+    }
     LOG_ERROR<<"TcpConnection::handleError name:"<<name_.c_str()<<"- SO_ERROR:%"<<err;
 }
 
 // Execute sendfile in the event loop
-void TcpConnection::sendFile(int fileDescriptor, off_t offset, size_t count) {
+void TcpConnection::sendFile(int fileDescriptor, off_t offset, size_t count, const SendFileCallback &cb) {
     if (connected()) {
         if (loop_->isInLoopThread()) { // Determine whether the current thread is the loop thread
-            sendFileInLoop(fileDescriptor, offset, count);
+            sendFileInLoop(fileDescriptor, offset, count, cb);
         }else{ // If not, wake up the thread running this TcpConnection to execute the Loop loop
             loop_->runInLoop(
-                std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), fileDescriptor, offset, count));
+                std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), fileDescriptor, offset, count, cb));
         }
     } else {
         LOG_ERROR<<"TcpConnection::sendFile - not connected";
     }
 }
 
-// How many bytes were sent
-void TcpConnection::sendFileInLoop(int fileDescriptor, off_t offset, size_t count) {
-    ssize_t bytesSent = 0;
-    size_t remaining = count; // How much data is left to send
-    bool faultError = false; // Error flag
-
-    if (state_ == kDisconnecting) { // Indicates that the connection is already disconnected, so no data needs to be sent.
+// Queue the file range behind the pending output. The first chunk goes out right away if nothing is pending,
+// the rest is driven by EPOLLOUT through handleWrite, so a slow client no longer keeps the loop busy
+void TcpConnection::sendFileInLoop(int fileDescriptor, off_t offset, size_t count, const SendFileCallback &cb) {
+    if (state_ == kDisconnected) { // Indicates that the connection is already disconnected, so no data needs to be sent.
         LOG_ERROR<<"disconnected, give up writing";
         return;
     }
 
-    // Indicates that the Channel is writing data for the first time or the outputBuffer buffer has no data
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0) {
-        bytesSent = sendfile(socket_->fd(), fileDescriptor, &offset, remaining);
-        if (bytesSent >= 0) {
-            remaining -= bytesSent;
-            if (remaining == 0 && writeCompleteCallback_) {
-                // remaining being 0 means the data is exactly all sent, so there is no need to set the write event listener for it.
-                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
-            }
-        } else { // If it is a non-blocking no data return error, this is a normal phenomenon equivalent to EAGAIN, otherwise it is an abnormal situation
-            if (errno != EWOULDBLOCK) {
-                LOG_ERROR<<"TcpConnection::sendFileInLoop";
-            }
-            if (errno == EPIPE || errno == ECONNRESET) {
-                faultError = true;
-            }
-        }
-    }
-    // Handle remaining data
-    if (!faultError && remaining > 0) {
-        // Continue sending remaining data
-        loop_->queueInLoop(
-            std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), fileDescriptor, offset, remaining));
+    OutputQueue::ProgressCallback progress;
+    if (cb) {
+        // Only runs inside handleWrite/sendQueuedInLoop, while the connection is alive
+        progress = std::bind(&TcpConnection::handleSendFileProgress, this, cb, std::placeholders::_1, std::placeholders::_2);
     }
-}
\ No newline at end of file
+    size_t oldLen = outputQueue_.readableBytes();
+    outputQueue_.appendFile(fileDescriptor, offset, count, progress);
+    sendQueuedInLoop(oldLen);
+}
+
+void TcpConnection::handleSendFileProgress(const SendFileCallback &cb, size_t sent, size_t total)
+{
+    // Deferred, so the user callback may send again without touching outputQueue_ while it is being retrieved
+    loop_->queueInLoop(std::bind(cb, shared_from_this(), sent, total));
+}
@@ -1,4 +1,6 @@
 #include <functional>
+#include <future>
+#include <vector>
 #include <string.h>
 
 #include <TcpServer.h>
@@ -21,27 +23,84 @@ TcpServer::TcpServer(EventLoop *loop,
     : loop_(CheckLoopNotNull(loop))
     , ipPort_(listenAddr.toIpPort())
     , name_(nameArg)
-    , acceptor_(new Acceptor(loop, listenAddr, option == kReusePort))
+    , listenAddr_(listenAddr)
+    , option_(option)
+    , acceptor_(option == kReusePortPerLoop ? nullptr : new Acceptor(loop, listenAddr, option == kReusePort))
     , threadPool_(new EventLoopThreadPool(loop, name_))
     , connectionCallback_()
     , messageCallback_()
-    , nextConnId_(1)
     , started_(0)
+    , nextConnId_(1)
+    , edgeTriggered_(false)
+    , idleTimeout_(0)
+    , zeroCopyThreshold_(0)
+    , inputHighWaterMark_(0)
 {
     // When a new user connects, the acceptChannel_ bound in the Acceptor class will have a read event, executing handleRead() and calling TcpServer::newConnection callback
-    acceptor_->setNewConnectionCallback(
-        std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
+    if (acceptor_)
+    {
+        acceptor_->setNewConnectionCallback(
+            std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
+    }
 }
 
 TcpServer::~TcpServer()
 {
-    for(auto &item : connections_)
+    // Per-loop acceptors call back into this server from their own loops: delete each one there and wait,
+    // so no accept can run once the connections below are being torn down
+    std::vector<std::future<void>> acceptorsGone;
+    for (auto &item : loopAcceptors_)
+    {
+        Acceptor *acceptor = item.second.release();
+        auto done = std::make_shared<std::promise<void>>();
+        acceptorsGone.push_back(done->get_future());
+        item.first->runInLoop([acceptor, done]() {
+            delete acceptor;
+            done->set_value();
+        });
+    }
+    for (std::future<void> &gone : acceptorsGone)
+    {
+        gone.wait();
+    }
+
+    // Connections call back into this server from their io loops (close callback, reaper): hand every loop
+    // its connections and its reaper in one task and wait for all of them, so nothing can reach this server
+    // once its members are gone. Connections erased before the swap had their connectDestroyed queued ahead
+    std::unordered_map<EventLoop *, std::vector<TcpConnectionPtr>> loopConnections;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        for (auto &item : connections_)
+        {
+            loopConnections[item.second->getLoop()].push_back(std::move(item.second));
+        }
+        connections_.clear();
+    }
+    for (auto &item : idleReapers_)
+    {
+        loopConnections[item.first]; // A loop with a reaper but no connection left
+    }
+    std::vector<std::future<void>> loopsDone;
+    for (auto &item : loopConnections)
+    {
+        auto reaper = idleReapers_.find(item.first);
+        IdleReaper *loopReaper = reaper != idleReapers_.end() ? reaper->second.release() : nullptr;
+        auto done = std::make_shared<std::promise<void>>();
+        loopsDone.push_back(done->get_future());
+        item.first->runInLoop([conns = std::move(item.second), loopReaper, done]() {
+            for (const TcpConnectionPtr &conn : conns)
+            {
+                // A forceClose queued meanwhile still runs handleClose, it must not reach the server
+                conn->setCloseCallback([](const TcpConnectionPtr &) {});
+                conn->connectDestroyed();
+            }
+            delete loopReaper; // After the connectDestroyed calls, which detach the connections from it
+            done->set_value();
+        });
+    }
+    for (std::future<void> &done : loopsDone)
     {
-        TcpConnectionPtr conn(item.second);
-        item.second.reset();    // Reset the original smart pointer, let the stack TcpConnectionPtr conn point to the object, when conn goes out of scope, the object pointed by the smart pointer can be released
-        // Destroy connection
-        conn->getLoop()->runInLoop(
-            std::bind(&TcpConnection::connectDestroyed, conn));
+        done.wait();
     }
 }
 
@@ -52,13 +111,43 @@ void TcpServer::setThreadNum(int numThreads)
     threadPool_->setThreadNum(numThreads_);
 }
 
+// Select the poller used by the subloops; the baseloop was created by the user and keeps its own
+void TcpServer::setPollerBackend(Poller::Backend backend)
+{
+    threadPool_->setPollerBackend(backend);
+}
+
 // Start server listening
 void TcpServer::start()
 {
     if (started_.fetch_add(1) == 0)    // Prevent a TcpServer object from being started multiple times
     {
         threadPool_->start(threadInitCallback_);    // Start the underlying loop thread pool
-        loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        if (idleTimeout_ > 0)
+        {
+            for (EventLoop *ioLoop : threadPool_->getAllLoops())
+            {
+                IdleReaper *reaper = new IdleReaper(ioLoop, idleTimeout_);
+                idleReapers_[ioLoop].reset(reaper);
+                reaper->start();
+            }
+        }
+        if (option_ == kReusePortPerLoop)
+        {
+            // Every io loop gets its own listening socket on the same port, the kernel spreads new connections among them
+            for (EventLoop *ioLoop : threadPool_->getAllLoops())
+            {
+                Acceptor *acceptor = new Acceptor(ioLoop, listenAddr_, true);
+                acceptor->setNewConnectionCallback(
+                    std::bind(&TcpServer::newConnectionInLoop, this, ioLoop, std::placeholders::_1, std::placeholders::_2));
+                loopAcceptors_[ioLoop].reset(acceptor);
+                ioLoop->runInLoop(std::bind(&Acceptor::listen, acceptor));
+            }
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        }
     }
 }
 
@@ -67,9 +156,14 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
 {
     // Polling algorithm to select a subLoop to manage the channel corresponding to connfd
     EventLoop *ioLoop = threadPool_->getNextLoop(peerAddr.toIp());
+    newConnectionInLoop(ioLoop, sockfd, peerAddr);
+}
+
+// Runs in mainloop (connection handed over to ioLoop) or, in kReusePortPerLoop mode, in ioLoop itself (no handoff at all)
+void TcpServer::newConnectionInLoop(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr)
+{
     char buf[64] = {0};
-    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-    ++nextConnId_;  // Not set as atomic because it only executes in mainloop, no thread safety issues
+    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_.fetch_add(1)); // Atomic, per-loop acceptors run in parallel
     std::string connName = name_ + buf;
 
     LOG_INFO<<"TcpServer::newConnection ["<<name_.c_str()<<"]- new connection ["<<connName.c_str()<<"]from %s"<<peerAddr.toIpPort().c_str();
@@ -89,11 +183,24 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
                                             sockfd,
                                             localAddr,
                                             peerAddr));
-    connections_[connName] = conn;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        connections_[connName] = conn;
+    }
     // The callbacks below are set by the user to TcpServer => TcpConnection, while the Channel is bound to the four handlers set by TcpConnection: handleRead, handleWrite... These callbacks are used in the handleXXX functions
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setEdgeTriggered(edgeTriggered_);
+    conn->setInputHighWaterMark(inputHighWaterMark_);
+    if (zeroCopyThreshold_ > 0)
+    {
+        conn->setZeroCopyThreshold(zeroCopyThreshold_);
+    }
+    if (idleTimeout_ > 0)
+    {
+        conn->setIdleReaper(idleReapers_.at(ioLoop).get());
+    }
 
     // Set the callback for how to close the connection
     conn->setCloseCallback(
@@ -103,10 +210,11 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
         std::bind(&TcpConnection::connectEstablished, conn));
 }
 
+// Runs in the connection's io loop. connections_ is guarded by connectionsMutex_, so the connection is erased
+// right here rather than through a functor queued on the base loop, which could outlive the server
 void TcpServer::removeConnection(const TcpConnectionPtr &conn)
 {
-    loop_->runInLoop(
-        std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+    removeConnectionInLoop(conn);
 }
 
 void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
@@ -114,8 +222,9 @@ void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
     LOG_INFO<<"TcpServer::removeConnectionInLoop ["<<
              name_.c_str()<<"] - connection %s"<<conn->name().c_str();
 
+    std::lock_guard<std::mutex> lock(connectionsMutex_); // Held while queueing: ~TcpServer's task for this loop comes after
     connections_.erase(conn->name());
     EventLoop *ioLoop = conn->getLoop();
     ioLoop->queueInLoop(
         std::bind(&TcpConnection::connectDestroyed, conn));
-}
\ No newline at end of file
+}
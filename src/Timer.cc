@@ -1,5 +1,7 @@
 #include <Timer.h>
 
+std::atomic<int64_t> Timer::s_numCreated_(0);
+
 void Timer::restart(Timestamp now)
 {
     if (repeat_)
@@ -11,4 +13,17 @@ void Timer::restart(Timestamp now)
     {
         expiration_ = Timestamp();
     }
-}
\ No newline at end of file
+}
+
+void Timer::reset(TimerCallback cb, Timestamp when, double interval)
+{
+    callback_ = std::move(cb);
+    expiration_ = when;
+    interval_ = interval;
+    repeat_ = interval > 0.0;
+    sequence_ = ++s_numCreated_;
+    prev_ = nullptr;
+    next_ = nullptr;
+    slot_ = nullptr;
+    canceled_ = false;
+}
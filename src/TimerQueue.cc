@@ -7,6 +7,7 @@
 #include <sys/timerfd.h>
 #include <unistd.h>
 #include <string.h>
+#include <algorithm>
 
 int createTimerfd()
 {
@@ -27,43 +28,120 @@ TimerQueue::TimerQueue(EventLoop* loop)
     : loop_(loop),
       timerfd_(createTimerfd()),
       timerfdChannel_(loop_, timerfd_),
-      timers_()
+      upperCount_(0),
+      startMicroSeconds_(Timestamp::now().microSecondsSinceEpoch()),
+      tick_(0),
+      armedTick_(-1),
+      freeList_(nullptr),
+      callingExpiredTimers_(false)
 {
+    memset(near_, 0, sizeof(near_));
+    memset(nearBitmap_, 0, sizeof(nearBitmap_));
+    memset(levels_, 0, sizeof(levels_));
+
     timerfdChannel_.setReadCallback(
         std::bind(&TimerQueue::handleRead, this));
     timerfdChannel_.enableReading();
 }
 
 TimerQueue::~TimerQueue()
-{   
+{
     timerfdChannel_.disableAll();
     timerfdChannel_.remove();
     ::close(timerfd_);
     // Delete all timers
-    for (const Entry& timer : timers_)
+    auto deleteList = [](Timer* head) {
+        while (head)
+        {
+            Timer* next = head->next_;
+            delete head;
+            head = next;
+        }
+    };
+    for (Timer* head : near_)
+    {
+        deleteList(head);
+    }
+    for (auto& level : levels_)
+    {
+        for (Timer* head : level)
+        {
+            deleteList(head);
+        }
+    }
+    for (Timer* timer : expired_)
     {
-        delete timer.second;
+        delete timer;
     }
+    deleteList(freeList_);
 }
 
-void TimerQueue::addTimer(TimerCallback cb,
-                          Timestamp when,
-                          double interval)
+TimerId TimerQueue::addTimer(TimerCallback cb,
+                             Timestamp when,
+                             double interval)
 {
+    if (loop_->isInLoopThread())
+    {
+        Timer* timer = newTimer(std::move(cb), when, interval);
+        addTimerInLoop(timer);
+        return TimerId(timer, timer->sequence());
+    }
+
+    // Another thread can not touch the free list, the timer joins it once it is done
     Timer* timer = new Timer(std::move(cb), when, interval);
+    TimerId timerId(timer, timer->sequence()); // Read before posting, the loop may recycle the timer right away
     loop_->runInLoop(
         std::bind(&TimerQueue::addTimerInLoop, this, timer));
+    return timerId;
+}
+
+void TimerQueue::cancel(TimerId timerId)
+{
+    loop_->runInLoop(
+        std::bind(&TimerQueue::cancelInLoop, this, timerId));
 }
 
 void TimerQueue::addTimerInLoop(Timer* timer)
 {
-    // Whether the earliest timer trigger time has been replaced
-    bool eraliestChanged = insert(timer);
+    if (timer->canceled_)
+    {
+        recycle(timer); // Cancelled before this queued add ran
+        return;
+    }
+
+    // timerfd is disarmed only when the wheel is empty, and then the wheel stops turning:
+    // catch up with the clock so the new timer is not placed relative to a stale tick
+    if (armedTick_ < 0 && !callingExpiredTimers_)
+    {
+        tick_ = std::max(tick_, (Timestamp::now().microSecondsSinceEpoch() - startMicroSeconds_) / kTickMicroSeconds);
+    }
+    insert(timer);
+
+    // Timers added by expired callbacks are covered by the re-arm at the end of the batch
+    if (!callingExpiredTimers_)
+    {
+        rearm();
+    }
+}
+
+void TimerQueue::cancelInLoop(TimerId timerId)
+{
+    Timer* timer = timerId.timer_;
+    if (timer == nullptr || timer->sequence() != timerId.sequence_)
+    {
+        return; // Already run (one-shot) or cancelled, the Timer object may be serving another task now
+    }
 
-    // We need to reset the timerfd_ trigger time
-    if (eraliestChanged)
+    if (timer->slot_ != nullptr)
+    {
+        unlink(timer);
+        recycle(timer);
+    }
+    else
     {
-        resetTimerfd(timerfd_, timer->expiration());
+        // Either the timer is in the batch being run (possibly cancelling itself): do not run or repeat it.
+        // Or it was added from another thread and its addTimerInLoop is still queued: do not insert it
+        timer->canceled_ = true;
     }
 }
 
@@ -95,85 +173,291 @@ void TimerQueue::resetTimerfd(int timerfd_, Timestamp expiration)
     }
 }
 
-void ReadTimerFd(int timerfd) 
+void ReadTimerFd(int timerfd)
 {
     uint64_t read_byte;
     ssize_t readn = ::read(timerfd, &read_byte, sizeof(read_byte));
-    
+
     if (readn != sizeof(read_byte)) {
         LOG_ERROR << "TimerQueue::ReadTimerFd read_size < 0";
     }
 }
 
-// Return deleted timer nodes (std::vector<Entry> expired)
-std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now)
+// Advance the wheel to now and move every due timer into expired_
+void TimerQueue::getExpired(Timestamp now)
 {
-    std::vector<Entry> expired;
-    Entry sentry(now, reinterpret_cast<Timer*>(UINTPTR_MAX));
-    TimerList::iterator end = timers_.lower_bound(sentry);
-    std::copy(timers_.begin(), end, back_inserter(expired));
-    timers_.erase(timers_.begin(), end);
-    
-    return expired;
+    const int64_t target = (now.microSecondsSinceEpoch() - startMicroSeconds_) / kTickMicroSeconds;
+    if (target < tick_)
+    {
+        return;
+    }
+
+    tick_ = std::min(nextNearTick(), target + 1);
+    while (tick_ <= target)
+    {
+        int index = static_cast<int>(tick_ & kNearMask);
+        if (index == 0)
+        {
+            // The near wheel wrapped around: pull the next block of timers down from the upper levels
+            int level = 0;
+            int slot;
+            do
+            {
+                slot = static_cast<int>((tick_ >> (kNearBits + level * kLevelBits)) & kLevelMask);
+                cascade(level, slot);
+            } while (slot == 0 && ++level < kLevels);
+        }
+
+        for (Timer* timer = near_[index]; timer != nullptr; timer = timer->next_)
+        {
+            timer->slot_ = nullptr;
+            expired_.push_back(timer);
+        }
+        near_[index] = nullptr;
+        nearBitmap_[index / 64] &= ~(1ULL << (index % 64));
+
+        ++tick_;
+        // Jump over empty near slots up to the next non-empty one or the next cascade point
+        tick_ = std::min(nextNearTick(), target + 1);
+    }
 }
 
 void TimerQueue::handleRead()
 {
     Timestamp now = Timestamp::now();
     ReadTimerFd(timerfd_);
+    armedTick_ = -1; // timerfd is one-shot and has just fired
 
-    std::vector<Entry> expired = getExpired(now);
+    getExpired(now);
 
     // Iterate through expired timers and call their callbacks
     callingExpiredTimers_ = true;
-    for (const Entry& it : expired)
+    for (Timer* timer : expired_)
     {
-        it.second->run();
+        if (!timer->canceled_)
+        {
+            timer->run();
+        }
     }
     callingExpiredTimers_ = false;
-    
+
     // Reset these timers
-    reset(expired, now);
+    reset(now);
 }
 
-void TimerQueue::reset(const std::vector<Entry>& expired, Timestamp now)
+void TimerQueue::reset(Timestamp now)
 {
-    Timestamp nextExpire;
-    for (const Entry& it : expired)
+    for (Timer* timer : expired_)
     {
         // If it's a repeating task, continue execution
-        if (it.second->repeat())
+        if (timer->repeat() && !timer->canceled_)
         {
-            auto timer = it.second;
-            timer->restart(Timestamp::now());
+            timer->restart(now);
             insert(timer);
         }
         else
         {
-            delete it.second;
+            recycle(timer);
         }
+    }
+    expired_.clear();
 
-        // If timers were reinserted, need to continue resetting timerfd
-        if (!timers_.empty())
+    // Re-arm timerfd once for the whole batch
+    rearm();
+}
+
+void TimerQueue::insert(Timer* timer)
+{
+    int64_t expires = std::max(tickOf(timer->expiration()), tick_);
+    int64_t delta = expires - tick_;
+
+    if (delta < kNearSize)
+    {
+        int index = static_cast<int>(expires & kNearMask);
+        link(timer, &near_[index]);
+        nearBitmap_[index / 64] |= 1ULL << (index % 64);
+        return;
+    }
+
+    if (delta >= kMaxDelta)
+    {
+        expires = tick_ + kMaxDelta - 1; // Parked in the top level, re-inserted by value when cascaded
+        delta = kMaxDelta - 1;
+    }
+    int level = 0;
+    while (delta >= (1LL << (kNearBits + (level + 1) * kLevelBits)))
+    {
+        ++level;
+    }
+    int index = static_cast<int>((expires >> (kNearBits + level * kLevelBits)) & kLevelMask);
+    link(timer, &levels_[level][index]);
+    ++upperCount_;
+}
+
+void TimerQueue::link(Timer* timer, Timer** slot)
+{
+    timer->prev_ = nullptr;
+    timer->next_ = *slot;
+    if (*slot)
+    {
+        (*slot)->prev_ = timer;
+    }
+    *slot = timer;
+    timer->slot_ = slot;
+}
+
+void TimerQueue::unlink(Timer* timer)
+{
+    Timer** slot = timer->slot_;
+    if (timer->prev_)
+    {
+        timer->prev_->next_ = timer->next_;
+    }
+    else
+    {
+        *slot = timer->next_;
+    }
+    if (timer->next_)
+    {
+        timer->next_->prev_ = timer->prev_;
+    }
+    timer->prev_ = nullptr;
+    timer->next_ = nullptr;
+    timer->slot_ = nullptr;
+
+    if (slot >= near_ && slot < near_ + kNearSize)
+    {
+        if (*slot == nullptr)
+        {
+            int index = static_cast<int>(slot - near_);
+            nearBitmap_[index / 64] &= ~(1ULL << (index % 64));
+        }
+    }
+    else
+    {
+        --upperCount_;
+    }
+}
+
+void TimerQueue::cascade(int level, int index)
+{
+    Timer* timer = levels_[level][index];
+    levels_[level][index] = nullptr;
+    while (timer)
+    {
+        Timer* next = timer->next_;
+        --upperCount_;
+        insert(timer);
+        timer = next;
+    }
+}
+
+int TimerQueue::findNearSlot(int from, int to) const
+{
+    for (int word = from / 64; word * 64 < to; ++word)
+    {
+        uint64_t bits = nearBitmap_[word];
+        if (word == from / 64)
+        {
+            bits &= ~0ULL << (from % 64);
+        }
+        if (bits)
+        {
+            int index = word * 64 + __builtin_ctzll(bits);
+            return index < to ? index : -1;
+        }
+    }
+    return -1;
+}
+
+int64_t TimerQueue::nextNearTick() const
+{
+    int index = static_cast<int>(tick_ & kNearMask);
+    if (index == 0)
+    {
+        return tick_; // Cascade point
+    }
+    int found = findNearSlot(index, kNearSize);
+    return (tick_ - index) + (found >= 0 ? found : kNearSize);
+}
+
+void TimerQueue::rearm()
+{
+    int64_t next = -1;
+    int index = static_cast<int>(tick_ & kNearMask);
+    const int64_t base = tick_ - index;
+
+    // Earliest non-empty near slot, the ones below index belong to the next turn of the wheel
+    int found = findNearSlot(index, kNearSize);
+    if (found >= 0)
+    {
+        next = base + found;
+    }
+    else if ((found = findNearSlot(0, index)) >= 0)
+    {
+        next = base + kNearSize + found;
+    }
+    // Upper level timers need the wheel to visit the next cascade point
+    if (upperCount_ > 0)
+    {
+        int64_t cascadeTick = (index == 0) ? tick_ : base + kNearSize;
+        if (next < 0 || cascadeTick < next)
         {
-            resetTimerfd(timerfd_, (timers_.begin()->second)->expiration());
+            next = cascadeTick;
         }
     }
+
+    if (next == armedTick_)
+    {
+        return;
+    }
+    armedTick_ = next;
+    if (next < 0)
+    {
+        struct itimerspec newValue;
+        memset(&newValue, '\0', sizeof(newValue));
+        ::timerfd_settime(timerfd_, 0, &newValue, nullptr); // Nothing left, disarm
+    }
+    else
+    {
+        resetTimerfd(timerfd_, timeOfTick(next));
+    }
 }
 
-bool TimerQueue::insert(Timer* timer)
+int64_t TimerQueue::tickOf(Timestamp when) const
 {
-    bool earliestChanged = false;
-    Timestamp when = timer->expiration();
-    TimerList::iterator it = timers_.begin();
-    if (it == timers_.end() || when < it->first)
+    int64_t dif = when.microSecondsSinceEpoch() - startMicroSeconds_;
+    if (dif <= 0)
     {
-        // The earliest timer has been replaced
-        earliestChanged = true;
+        return 0;
     }
+    return (dif + kTickMicroSeconds - 1) / kTickMicroSeconds; // Round up so a timer never fires early
+}
 
-    // Insert this new timer into the timer management red-black tree
-    timers_.insert(Entry(when, timer));
+Timestamp TimerQueue::timeOfTick(int64_t tick) const
+{
+    return Timestamp(startMicroSeconds_ + tick * kTickMicroSeconds);
+}
 
-    return earliestChanged;
-}
\ No newline at end of file
+Timer* TimerQueue::newTimer(TimerCallback cb, Timestamp when, double interval)
+{
+    if (freeList_ == nullptr)
+    {
+        return new Timer(std::move(cb), when, interval);
+    }
+    Timer* timer = freeList_;
+    freeList_ = timer->next_;
+    timer->reset(std::move(cb), when, interval);
+    return timer;
+}
+
+void TimerQueue::recycle(Timer* timer)
+{
+    timer->callback_ = nullptr; // Release whatever the callback captured
+    timer->sequence_ = 0;       // Stale TimerIds no longer match
+    timer->canceled_ = false;
+    timer->slot_ = nullptr;
+    timer->prev_ = nullptr;
+    timer->next_ = freeList_;
+    freeList_ = timer;
+}
@@ -1,61 +1,37 @@
 #include <string>
 
-#include <TcpServer.h>
+#include <HttpServer.h>
+#include <StaticFileHandler.h>
 #include <Logger.h>
 #include <sys/stat.h>
 #include <sstream>
 #include "AsyncLogging.h"
-#include "LFU.h"
 #include "memoryPool.h"
 // Log file roll size is 1MB (1*1024*1024 bytes)
 static const off_t kRollSize = 1*1024*1024;
-class EchoServer
+// Request handler: a welcome page at "/", 404 for anything else
+void onRequest(const HttpRequest &req, HttpResponse *resp)
 {
-public:
-    EchoServer(EventLoop *loop, const InetAddress &addr, const std::string &name)
-        : server_(loop, addr, name)
-        , loop_(loop)
+    if (req.method() != HttpRequest::kGet && req.method() != HttpRequest::kHead)
     {
-        // Register callback functions
-        server_.setConnectionCallback(
-            std::bind(&EchoServer::onConnection, this, std::placeholders::_1));
-        
-        server_.setMessageCallback(
-            std::bind(&EchoServer::onMessage, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-
-        // Set an appropriate number of subloop threads
-        server_.setThreadNum(3);
-    }
-    void start()
-    {
-        server_.start();
+        resp->setStatusCode(HttpResponse::k405MethodNotAllowed);
+        resp->addHeader("Allow", "GET, HEAD");
+        return;
     }
-
-private:
-    // Callback function for connection establishment or disconnection
-    void onConnection(const TcpConnectionPtr &conn)   
+    if (req.path() == "/")
     {
-        if (conn->connected())
-        {
-            LOG_INFO<<"Connection UP :"<<conn->peerAddress().toIpPort().c_str();
-        }
-        else
-        {
-            LOG_INFO<<"Connection DOWN :"<<conn->peerAddress().toIpPort().c_str();
-        }
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/html");
+        resp->setBody("<html><head><title>Ronald WebServer</title></head>"
+                      "<body><h1>Hello from Ronald WebServer</h1></body></html>");
     }
-
-    // Read/write event callback
-    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp time)
+    else
     {
-        std::string msg = buf->retrieveAllAsString();
-        conn->send(msg);
-        // conn->shutdown();   // Close the write end, underlying responds with EPOLLHUP => triggers closeCallback_
+        resp->setStatusCode(HttpResponse::k404NotFound);
+        resp->setContentType("text/plain");
+        resp->setBody("404 Not Found\n");
     }
-    TcpServer server_;
-    EventLoop *loop_;
-
-};
+}
 AsyncLogging* g_asyncLog = NULL;
 AsyncLogging * getAsyncLog(){
     return g_asyncLog;
@@ -80,17 +56,25 @@ int main(int argc,char *argv[]) {
     g_asyncLog = &log;
     Logger::setOutput(asyncLog); // Set output callback for Logger, reconfigure output location
     log.start(); // Start the log backend thread
-    // Step 2: Start memory pool and LFU cache
+    // Step 2: Start memory pool
      // Initialize memory pool
     memoryPool::HashBucket::initMemoryPool();
-
-    // Initialize cache
-    const int CAPACITY = 5;  
-    RonaldCache::RLfuCache<int, std::string> lfu(CAPACITY);
     // Step 3: Start the underlying network module
     EventLoop loop;
     InetAddress addr(8080);
-    EchoServer server(&loop, addr, "EchoServer");
+    HttpServer server(&loop, addr, "HttpServer");
+    // With a document root argument the files under it are served, otherwise the welcome page
+    std::unique_ptr<StaticFileHandler> staticFiles;
+    if (argc > 1)
+    {
+        staticFiles.reset(new StaticFileHandler(argv[1]));
+        server.setHttpCallback(std::bind(&StaticFileHandler::handle, staticFiles.get(), std::placeholders::_1, std::placeholders::_2));
+    }
+    else
+    {
+        server.setHttpCallback(onRequest);
+    }
+    server.setThreadNum(3); // Set an appropriate number of subloop threads
     server.start();
  // Main loop starts event loop, epoll_wait blocks and waits for ready events (main loop only registers the listening socket fd, so it only handles new connection events)
     std::cout << "================================================Start Web Server================================================" << std::endl;